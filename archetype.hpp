@@ -2,8 +2,13 @@
 
 #include <numeric>
 #include <cstring>
+#include <istream>
+#include <span>
+#include <sstream>
+#include <utility>
 
 #include "hash_map.hpp"
+#include "segmented_vector.hpp"
 #include "sparse_map.hpp"
 #include "component.hpp"
 #include "mem_block.hpp"
@@ -19,34 +24,115 @@ namespace ecs {
 
             archetype() = default;
 
-            explicit archetype(component_meta_set components) : components_(components) {
-                max_size_ = get_max_size(components_);
+            /// @brief Construct archetype
+            /// @param components component set
+            /// @param index registry component index the component set IDs are taken from
+            /// @param storage storage for full size chunks
+            /// @param small_storage optional storage for small chunks. If given and rows are small
+            /// enough, the archetype starts with a small_mem_block_size chunk carved out of a shared
+            /// slab and graduates to full size chunks once that is full.
+            /// @param clock optional change version counter, see archetype_registry::version. Rows
+            /// added, moved or removed and mutable access through get() stamp their chunk with it.
+            archetype(component_meta_set components, const component_index& index,
+                block_storage& storage = heap_storage::instance(), block_storage* small_storage = nullptr,
+                const std::uint64_t* clock = nullptr)
+                : components_(components), index_(&index), storage_(&storage), small_storage_(small_storage), clock_(clock) {
+                block_size_ = block_size_class(components_);
+                if (small_storage_ != nullptr && block_size_ == mem_block::mem_block_size
+                    && layout_size(components_, min_small_rows) <= mem_block::small_mem_block_size) {
+                    block_size_ = mem_block::small_mem_block_size;
+                }
+                max_size_ = get_max_size(components_, block_size_);
                 //std::cout << "Max size: " << max_size_ << std::endl;
-                init_component_sections(components_);
-                mem_blocks_.emplace_back(mem_blocks_info_, max_size_);
+                init_component_sections(mem_blocks_info_, components_, max_size_);
+                mem_blocks_.emplace_back(mem_blocks_info_, *index_, max_size_, current_storage(), block_size_);
             }
 
             template<component... Components>
             entity_location emplace_back(entity ent, Components&&... components) {
-                auto& free_mem_block = ensure_free_mem_block();
-                auto entry_index = free_mem_block.size();
-                auto mem_block_index = mem_blocks_.size() - 1;
+                return emplace_back_with([&](mem_block& mb) {
+                    mb.emplace_back(ent, std::forward<Components>(components)...);
+                });
+            }
 
-                free_mem_block.emplace_back(ent, std::forward<Components>(components)...);
+            /// @brief Append an entity constructing each component in place from a tuple of
+            /// constructor arguments
+            /// @param ent entity
+            /// @param args one tuple of constructor arguments per component
+            /// @return entity_location
+            template<component... Components, typename... Tuples>
+            entity_location emplace_back_piecewise(entity ent, Tuples&&... args) {
+                return emplace_back_with([&](mem_block& mb) {
+                    mb.template emplace_back_piecewise<Components...>(ent, std::forward<Tuples>(args)...);
+                });
+            }
 
-                return entity_location {
-                    this, mem_block_index, entry_index
-                };
+            /// @brief Append an entity with default initialized components
+            /// @param ent entity
+            /// @return entity_location
+            template<component... Components>
+            entity_location emplace_back_uninitialized(entity ent) {
+                return emplace_back_with([&](mem_block& mb) {
+                    mb.template emplace_back_uninitialized<Components...>(ent);
+                });
+            }
+
+            /// @brief Move the row at loc of another archetype into this one, constructing the given
+            /// components in place. Components this archetype lacks are left in the source row, which
+            /// has to be erased afterwards.
+            /// @param src archetype holding the row
+            /// @param loc location of the row in src
+            /// @param components components src does not have
+            /// @return entity_location location of the row in this archetype
+            template<component... Components>
+            entity_location emplace_back_from(archetype& src, const entity_location& loc, Components&&... components) {
+                return emplace_back_with([&](mem_block& mb) {
+                    mb.emplace_back_from(src.get_mem_block(loc), loc.entry_index, std::forward<Components>(components)...);
+                });
+            }
+
+            /// @brief Make sure the next emplace_back finds a free row. Unlike emplace_back, running
+            /// out of chunk storage is reported instead of thrown.
+            /// @return false if a new chunk was needed and the storage had none left
+            bool reserve_row() {
+                if (!mem_blocks_.back().full()) {
+                    return true;
+                }
+                if (small()) {
+                    graduate();
+                    return true;
+                }
+                auto* buffer = storage_->allocate(block_size_);
+                if (buffer == nullptr) {
+                    return false;
+                }
+                prepare(mem_blocks_.emplace_back(mem_blocks_info_, *index_, max_size_, *storage_, block_size_, buffer));
+                return true;
+            }
+
+            /// @brief Preallocate the chunk directory, appending up to chunks chunks does not allocate.
+            /// Chunks of an archetype with a reserved directory also get their tombstone mask when
+            /// they are created, so killing rows does not allocate either.
+            /// @param chunks number of chunks
+            void reserve(std::size_t chunks) {
+                mem_blocks_.reserve(chunks);
+                reserve_tombstones_ = chunks != 0;
+                for (auto& mb : mem_blocks_) {
+                    prepare(mb);
+                }
             }
 
             /// @brief erase an entity at given location, fill possible gap with last
             /// entity
             /// @param location enity location
             /// @return std::optional<entity>
-            std::optional<entity> erase_and_fill(const entity_location& loc) noexcept {
+            /// @throws std::bad_alloc if a compressed chunk cannot be decompressed, nothing is erased then
+            std::optional<entity> erase_and_fill(const entity_location& loc) {
                 auto& mem_block = get_mem_block(loc); //get mem_block of location
                 auto& crnt_mem_block = mem_blocks_.back(); //get current mem_block thats being used
                 auto opt_ent = mem_block.erase_and_fill(loc.entry_index, crnt_mem_block);
+                mem_block.mark_changed(current_version());
+                crnt_mem_block.mark_changed(current_version());
 
                 if(crnt_mem_block.empty() && mem_blocks_.size() > 1) {
                     mem_blocks_.pop_back();
@@ -55,6 +141,87 @@ namespace ecs {
                 return opt_ent;
             }
 
+            /// @brief Decompress the chunks erase_and_fill(loc) touches, so that it does not fail
+            /// after the row has been copied elsewhere
+            /// @param loc entity location
+            void ensure_resident(const entity_location& loc) {
+                get_mem_block(loc).ensure_resident();
+                mem_blocks_.back().ensure_resident();
+            }
+
+            /// @brief Mark the row at loc dead, see compact()
+            /// @param loc entity location
+            void kill(const entity_location& loc) {
+                auto& mb = get_mem_block(loc);
+                mb.kill(loc.entry_index);
+                mb.mark_changed(current_version());
+            }
+
+            /// @brief Remove all dead rows in a single streaming pass over the chunks. Live rows move
+            /// forward to the first free slot, so their relative order is preserved and every chunk
+            /// but the last ends up full. Emptied chunks at the end are released.
+            /// @param on_move called with each moved entity and its new location
+            /// @return number of removed rows
+            std::size_t compact(auto&& on_move) {
+                std::size_t removed = 0;
+                for (const auto& mb : mem_blocks_) {
+                    removed += mb.dead_count();
+                }
+                if (removed == 0) {
+                    return 0;
+                }
+                // decompress up front, running out of memory halfway would leave rows destroyed twice
+                for (const auto& mb : mem_blocks_) {
+                    mb.ensure_resident();
+                }
+                for (auto& mb : mem_blocks_) {
+                    mb.destroy_dead();
+                }
+
+                // write cursor (chunk, row) trails the read cursor, slots in between are raw memory
+                std::size_t write_chunk = 0;
+                std::size_t write_row = 0;
+                for (std::size_t chunk = 0; chunk < mem_blocks_.size(); ++chunk) {
+                    auto& src = mem_blocks_[chunk];
+                    std::size_t row = 0;
+                    while (row < src.size()) {
+                        if (src.dead(row)) {
+                            row++;
+                            continue;
+                        }
+                        // move maximal runs of live rows, one column at a time
+                        auto& dst = mem_blocks_[write_chunk];
+                        const auto limit = std::min(src.size() - row, dst.max_size() - write_row);
+                        std::size_t run = 1;
+                        while (run < limit && !src.dead(row + run)) {
+                            run++;
+                        }
+                        if (chunk != write_chunk || row != write_row) {
+                            dst.relocate(write_row, src, row, run);
+                            for (std::size_t i = write_row; i < write_row + run; ++i) {
+                                on_move(*dst.template const_ptr<entity>(i), entity_location{ this, write_chunk, i });
+                            }
+                        }
+                        row += run;
+                        write_row += run;
+                        if (write_row == dst.max_size()) {
+                            write_chunk++;
+                            write_row = 0;
+                        }
+                    }
+                }
+
+                for (std::size_t chunk = 0; chunk < mem_blocks_.size(); ++chunk) {
+                    const auto rows = chunk < write_chunk ? mem_blocks_[chunk].max_size() : chunk == write_chunk ? write_row : 0;
+                    mem_blocks_[chunk].truncate(rows);
+                    mem_blocks_[chunk].mark_changed(current_version());
+                }
+                while (mem_blocks_.size() > 1 && mem_blocks_.back().empty()) {
+                    mem_blocks_.pop_back();
+                }
+                return removed;
+            }
+
             /// @brief Get component data
             ///
             /// @tparam ComponentRef Component reference type
@@ -62,7 +229,10 @@ namespace ecs {
             /// @param loc Entity location
             /// @return Component& Component reference
             template<component_reference ComponentRef>
-            ComponentRef get(entity_location loc) {
+            component_reference_t<ComponentRef> get(entity_location loc) {
+                if constexpr (!std::is_const_v<std::remove_reference_t<ComponentRef>>) {
+                    get_mem_block(loc).mark_changed(index_->template find<std::decay_t<ComponentRef>>(), current_version());
+                }
                 return get_component_reference<ComponentRef>(*this, loc);
             }
 
@@ -73,67 +243,171 @@ namespace ecs {
             /// @param loc Entity location
             /// @return ComponentRef Component reference
             template<component_reference ComponentRef>
-            ComponentRef get(entity_location loc) const {
+            component_reference_t<ComponentRef> get(entity_location loc) const {
                 static_assert( std::is_const_v<std::remove_reference_t<ComponentRef>>,
                     "Can only get a non-const reference on const archetype");
                 return get_component_reference<ComponentRef>(*this, loc);
             }
 
+            /// @brief Version of the last change to the column of C in any chunk of this archetype
+            /// @tparam C component type
+            /// @return std::uint64_t the version, 0 if the column never changed or does not exist
+            template<component C>
+            [[nodiscard]] std::uint64_t version() const noexcept {
+                auto iter = mem_blocks_info_.find(index_->template find<C>());
+                return iter != mem_blocks_info_.end() ? iter->second.version : 0;
+            }
+
             template<component C>
             [[nodiscard]] bool contains() const noexcept {
                 if constexpr (std::is_same_v<C, entity>) {
                     return true;
                 } else {
-                    return components_.contains<C>();
+                    return components_.contains<C>(*index_);
                 }
             };
 
             [[nodiscard]] bool contains(component_id_t component_id) const noexcept {
-                if (component_id == component_id::value<entity>) {
+                if (component_id == component_index::entity_id) {
                     return true;
                 } else {
                     return components_.contains(component_id);
                 }
             }
 
-            [[nodiscard]] std::vector<mem_block>& mem_blocks() noexcept {
+            [[nodiscard]] const component_meta_set& components() const noexcept {
+                return components_;
+            }
+
+            /// @brief Archetype an entity of this archetype ends up in after a structural change
+            /// @param change added and removed components, see archetype_registry::ensure_archetype
+            /// @return archetype* or nullptr if the change has not been cached yet
+            [[nodiscard]] archetype* find_transition(const component_set& change) const {
+                auto iter = transitions_.find(change);
+                return iter != transitions_.end() ? iter->second : nullptr;
+            }
+
+            /// @brief Remember the archetype a structural change leads to
+            /// @param change added and removed components
+            /// @param target archetype after the change
+            void cache_transition(const component_set& change, archetype* target) {
+                transitions_.insert_or_assign({change, target});
+            }
+
+            /// @brief Chunk directory. Chunks never move, appending one keeps references and pointers
+            /// to the others valid.
+            [[nodiscard]] segmented_vector<mem_block>& mem_blocks() noexcept {
                 return mem_blocks_;
             }
 
-            [[nodiscard]] const std::vector<mem_block>& mem_blocks() const noexcept {
+            [[nodiscard]] const segmented_vector<mem_block>& mem_blocks() const noexcept {
                 return mem_blocks_;
             }
 
+            /// @brief Size of the chunks of this archetype
+            [[nodiscard]] std::size_t block_size() const noexcept {
+                return block_size_;
+            }
+
+            /// @brief Whether the archetype still lives in a small chunk of a shared slab
+            [[nodiscard]] bool small() const noexcept {
+                return block_size_ < mem_block::mem_block_size;
+            }
+
+            /// @brief Replace the chunks of an empty archetype with buffers that already hold rows in
+            /// its layout, e.g. blocks of a storage file reopened after a restart. The rows are taken
+            /// as they are and stamped as changed.
+            /// @param chunks buffer and number of rows of each chunk, allocated from the full size
+            /// chunk storage of this archetype
+            void restore(std::span<const std::pair<std::byte*, std::size_t>> chunks) {
+                assert((!small() && mem_blocks_.size() == 1 && mem_blocks_.front().empty()) && "Only an empty archetype can be restored");
+                if (chunks.empty()) {
+                    return;
+                }
+                mem_blocks_.clear();
+                for (const auto& [buffer, rows] : chunks) {
+                    prepare(mem_blocks_.emplace_back(mem_blocks_info_, *index_, max_size_, *storage_, block_size_, buffer, rows))
+                        .mark_changed(current_version());
+                }
+            }
+
+            /// @brief Give up all chunk buffers without returning them to the storage, see
+            /// mem_block::detach
+            void detach() noexcept {
+                for (auto& mb : mem_blocks_) {
+                    mb.detach();
+                }
+            }
+
+            /// @brief Maximum number of rows per chunk
+            [[nodiscard]] std::size_t max_size() const noexcept {
+                return max_size_;
+            }
+
         private:
 
-            void init_component_sections(const component_meta_set& components_meta) {
+            /// @brief Minimum number of rows a small chunk has to fit
+            static constexpr std::size_t min_small_rows = 4;
+
+            /// @brief Minimum number of rows a large chunk has to fit
+            static constexpr std::size_t min_large_rows = 8;
+
+            /// @brief Chunk size for the given components. Archetypes whose rows do not fit into a
+            /// mem_block_size chunk use the smallest power of two multiple of it holding
+            /// min_large_rows rows, so oversized components stay inline and contiguous.
+            static std::size_t block_size_class(const component_meta_set& components_meta) noexcept {
+                auto block_size = mem_block::mem_block_size;
+                if (layout_size(components_meta, 1) <= block_size) {
+                    return block_size;
+                }
+                while (layout_size(components_meta, min_large_rows) > block_size) {
+                    block_size *= 2;
+                }
+                return block_size;
+            }
+
+            static void init_component_sections(sparse_map<component_id_t, block_metadata>& info,
+                const component_meta_set& components_meta, std::size_t max_size) {
                 // make space for entity
-                auto offset = add_component_section(0, component_meta::of<entity>());
+                auto offset = add_component_section(info, 0, component_meta::of_entity(), max_size);
                 // space for all components
                 for (const auto& meta : components_meta) {
-                    offset = add_component_section(offset, meta);
+                    offset = add_component_section(info, offset, meta, max_size);
+                }
+            }
+
+            static std::size_t add_component_section(sparse_map<component_id_t, block_metadata>& info,
+                std::size_t offset, const component_meta& meta, std::size_t max_size) {
+                const std::size_t size_in_bytes = column_size(meta, max_size);
+                offset = align_up(offset, column_align(meta));
+                info.emplace(meta.id, offset, meta, info.size());
+                return offset + size_in_bytes;
+            }
+
+            /// @brief Size of the column layout for max_size entities
+            static std::size_t layout_size(const component_meta_set& components_meta, std::size_t max_size) noexcept {
+                auto end = align_up(0, alignof(entity)) + max_size * sizeof(entity);
+                for (const auto& meta : components_meta) {
+                    end = align_up(end, column_align(meta)) + column_size(meta, max_size);
                 }
+                return end;
             }
 
-            std::size_t add_component_section(std::size_t offset, const component_meta& meta) {
-                const std::size_t size_in_bytes = max_size_ * meta.type->size;
-                const std::size_t align = meta.type->align;
-                mem_blocks_info_.emplace(meta.id, offset, meta);
-                offset += mod_2n(offset, align) + size_in_bytes;
-                return offset;
+            static constexpr std::size_t align_up(std::size_t offset, std::size_t align) noexcept {
+                return (offset + align - 1U) & ~(align - 1U);
             }
 
-            static std::size_t get_max_size(auto&& components_meta) {
+            static std::size_t get_max_size(const component_meta_set& components_meta, std::size_t block_size) {
                 auto aligned_size = aligned_components_size(components_meta);
                 //std::cout << "Alinged components size: " << aligned_size << std::endl;
 
                 // handle subtraction overflow - memory block size is insufficient to hold at least one such entity
-                if (aligned_size > mem_block::mem_block_size) [[unlikely]] {
+                if (aligned_size > block_size) [[unlikely]] {
                     throw std::overflow_error("Mem block too small for component size");
                 }
 
                 // Remaining size for packed components
-                auto remaining_space = mem_block::mem_block_size - aligned_size;
+                auto remaining_space = block_size - aligned_size;
                 //std::cout << "Remaining space: " << remaining_space << std::endl;
 
                 // Calculate how much components we can pack into remaining space
@@ -142,13 +416,22 @@ namespace ecs {
                 //std::cout << "Remaining elements count: " << remaining_elements_count << std::endl;
 
                 // The maximum amount of entities we can hold is grater by 1 for which we calculated aligned_size
-                return remaining_elements_count + 1;
+                auto max_size = remaining_elements_count + 1;
+
+                // The estimate does not account for padding between every column, shrink until the layout fits
+                while (max_size > 1 && layout_size(components_meta, max_size) > block_size) {
+                    max_size--;
+                }
+                if (layout_size(components_meta, max_size) > block_size) [[unlikely]] {
+                    throw std::overflow_error("Mem block too small for component size");
+                }
+                return max_size;
             }
 
             static std::size_t packed_components_size(auto&& components_meta) noexcept {
                 return std::accumulate(components_meta.begin(),
                     components_meta.end(),
-                    component_meta::of<entity>().type->size,
+                    sizeof(entity),
                     [](const auto& res, const auto& meta) { return res + meta.type->size; });
             }
 
@@ -167,7 +450,7 @@ namespace ecs {
                     //std::cout << "End + size " << meta.type->size << std::endl;
                 };
 
-                add_elements(component_meta::of<entity>());
+                add_elements(component_meta::of_entity());
                 for (const auto& meta : components_meta) {
                     add_elements(meta);
                 }
@@ -175,13 +458,69 @@ namespace ecs {
                 return end - begin;
             }
 
+            /// @brief Run construct on a chunk with a free row and return the location of that row
+            entity_location emplace_back_with(auto&& construct) {
+                auto& free_mem_block = ensure_free_mem_block();
+                auto entry_index = free_mem_block.size();
+                auto mem_block_index = mem_blocks_.size() - 1;
+
+                construct(free_mem_block);
+                free_mem_block.mark_changed(current_version());
+
+                return entity_location {
+                    this, mem_block_index, entry_index
+                };
+            }
+
             mem_block& ensure_free_mem_block() {
                 auto& mb = mem_blocks_.back();
                 if(!mb.full()) {
                     return mb;
                 }
-                mem_blocks_.emplace_back(mem_blocks_info_, max_size_);
-                return mem_blocks_.back();
+                if (small()) {
+                    graduate();
+                    return mem_blocks_.back();
+                }
+                return prepare(mem_blocks_.emplace_back(mem_blocks_info_, *index_, max_size_, *storage_, block_size_));
+            }
+
+            /// @brief Move the rows of the small chunk into a dedicated full size chunk. Rows keep
+            /// their indices, so entity locations stay valid.
+            void graduate() {
+                mem_blocks_.front().ensure_resident();
+                sparse_map<component_id_t, block_metadata> info{};
+                const auto max_size = get_max_size(components_, mem_block::mem_block_size);
+                init_component_sections(info, components_, max_size);
+
+                // allocate first, the archetype is left untouched if that fails
+                auto* buffer = storage_->allocate(mem_block::mem_block_size);
+                if (buffer == nullptr) {
+                    throw std::bad_alloc{};
+                }
+
+                // the block is built on the new layout, so its flag columns are zeroed at their new offsets
+                std::swap(mem_blocks_info_, info);
+                mem_block full_block(mem_blocks_info_, *index_, max_size, *storage_, mem_block::mem_block_size, buffer);
+                full_block.take(mem_blocks_.front(), info);
+                mem_blocks_.front() = std::move(full_block);
+                prepare(mem_blocks_.front()).mark_changed(current_version());
+                block_size_ = mem_block::mem_block_size;
+                max_size_ = max_size;
+            }
+
+            [[nodiscard]] std::uint64_t current_version() const noexcept {
+                return clock_ != nullptr ? *clock_ : 0;
+            }
+
+            mem_block& prepare(mem_block& mb) {
+                if (reserve_tombstones_) {
+                    mb.reserve_tombstones();
+                }
+                return mb;
+            }
+
+            [[nodiscard]] block_storage& current_storage() const noexcept {
+                return small() ? *small_storage_ : *storage_;
             }
 
             inline mem_block& get_mem_block(entity_location loc) noexcept {
@@ -192,16 +531,24 @@ namespace ecs {
             }
 
             template<component_reference ComponentRef>
-            inline static ComponentRef get_component_reference(auto&& self, entity_location loc) {
+            inline static component_reference_t<ComponentRef> get_component_reference(auto&& self, entity_location loc) {
                 auto& mem_block = self.get_mem_block(loc);
                 assert((loc.entry_index < mem_block.size()) && "Entity location index exeeds memory block size");
                 return *component_fetch::fetch_pointer<ComponentRef>(mem_block, loc.entry_index);
             }
 
             component_meta_set components_{};
+            const component_index* index_{};
+            block_storage* storage_{};
+            block_storage* small_storage_{};
+            const std::uint64_t* clock_{};
+            std::size_t block_size_{};
             std::size_t max_size_{};
-            std::vector<mem_block> mem_blocks_{};
+            bool reserve_tombstones_{ false };
+            // declared before the blocks, which use it until they are destroyed
             sparse_map<component_id_t, block_metadata> mem_blocks_info_;
+            segmented_vector<mem_block> mem_blocks_{};
+            hash_map<component_set, archetype*, component_set_hasher> transitions_{};
     };
 
     /// @brief Container for archetypes, stores map [component_set => archetype]
@@ -211,6 +558,40 @@ namespace ecs {
 
             using storage_type_t = hash_map<component_set, std::unique_ptr<archetype>, component_set_hasher>;
 
+            /// @brief Construct archetype registry
+            /// @param storage storage chunk buffers are allocated from
+            /// @param small_chunks whether tiny archetypes start in regions of shared slabs
+            explicit archetype_registry(block_storage& storage = heap_storage::instance(), bool small_chunks = true) noexcept
+                : block_storage_(&storage),
+                  small_storage_(storage, mem_block::mem_block_size, mem_block::small_mem_block_size),
+                  small_chunks_(small_chunks) {}
+
+            /// @brief Find the archetype matching the passed Components types without creating it
+            ///
+            /// @tparam Components Component types
+            /// @return archetype* or nullptr if there is none yet
+            template<component... Components>
+            archetype* find_archetype() {
+                tmp_component_set_.clear();
+                (..., tmp_component_set_.insert<Components>(index_));
+
+                auto iter = archetypes_.find(tmp_component_set_);
+                return iter != archetypes_.end() ? iter->second.get() : nullptr;
+            }
+
+            /// @brief Preallocate room for archetypes and for the chunk directory of each archetype
+            ///
+            /// @param archetypes number of archetypes
+            /// @param chunks number of chunks per archetype
+            void reserve(std::size_t archetypes, std::size_t chunks) {
+                // keep the load factor low enough that inserting archetypes never rehashes
+                archetypes_.reserve(archetypes * 2);
+                reserved_chunks_ = chunks;
+                for (auto& [components, archetype] : archetypes_) {
+                    archetype->reserve(chunks);
+                }
+            }
+
             /// @brief Get or create an archetype matching the passed Components types
             ///
             /// @tparam Components Component types
@@ -218,13 +599,111 @@ namespace ecs {
             template<component... Components>
             archetype* ensure_archetype() {
                 tmp_component_set_.clear();
-                (..., tmp_component_set_.insert<Components>());
+                (..., tmp_component_set_.insert<Components>(index_));
+
+                const auto hash = archetypes_.hash_function()(tmp_component_set_);
+                if (auto iter = archetypes_.find_with_hash(tmp_component_set_, hash); iter != archetypes_.end()) {
+                    return iter->second.get();
+                }
+                return insert_archetype(component_meta_set::create<Components...>(index_), hash);
+            }
 
-                auto& archetype = archetypes_[tmp_component_set_];
-                if (!archetype) {
-                    archetype = create_archetype(component_meta_set::create<Components...>());
+            /// @brief Get or create the archetype an entity of base ends up in after adding Added and
+            /// removing Removed, without creating any intermediate archetype. The result is cached in
+            /// base, so repeating the change costs a single lookup.
+            ///
+            /// @tparam Added Added component types
+            /// @tparam Removed Removed component types
+            /// @param base Current archetype
+            /// @return archetype*
+            template<component... Added, component... Removed>
+            archetype* ensure_archetype(archetype& base, add<Added...>, remove<Removed...>) {
+                tmp_change_.clear();
+                (..., insert_change<Added>(tmp_change_, false));
+                (..., insert_change<Removed>(tmp_change_, true));
+                if (auto* target = base.find_transition(tmp_change_)) {
+                    return target;
                 }
-                return archetype.get();
+
+                auto components = base.components();
+                (..., components.erase<Removed>(index_));
+                (..., components.insert<Added>(index_));
+                auto* target = ensure_archetype(std::move(components));
+                base.cache_transition(tmp_change_, target);
+                return target;
+            }
+
+            /// @brief Get or create the archetype with the given components
+            ///
+            /// @param components Component set
+            /// @return archetype*
+            archetype* ensure_archetype(component_meta_set components) {
+                const auto hash = archetypes_.hash_function()(components.ids());
+                if (auto iter = archetypes_.find_with_hash(components.ids(), hash); iter != archetypes_.end()) {
+                    return iter->second.get();
+                }
+                return insert_archetype(std::move(components), hash);
+            }
+
+            /// @brief Create the archetypes and transitions listed in a text stream, one per line.
+            /// A line names the components of an archetype, optionally followed by '>' and a
+            /// structural change of +added and -removed components, which creates the target
+            /// archetype and caches the transition. Text after '#' is ignored.
+            ///
+            ///     position velocity
+            ///     position velocity > +target -velocity   # start chasing
+            ///
+            /// @param in Input stream
+            /// @param catalog Component names
+            /// @return std::size_t Number of archetypes created
+            /// @throws std::invalid_argument on an unknown component name or a malformed line
+            std::size_t declare(std::istream& in, const component_catalog& catalog) {
+                const auto archetypes = size();
+                std::string line;
+                std::size_t line_number = 0;
+                while (std::getline(in, line)) {
+                    line_number++;
+                    line = line.substr(0, line.find('#'));
+                    std::istringstream tokens{line};
+                    std::string token;
+                    component_meta_set components;
+                    component_meta_set added;
+                    component_meta_set removed;
+                    bool change = false;
+                    while (tokens >> token) {
+                        if (token == ">") {
+                            change = true;
+                        } else if (!change) {
+                            catalog.insert(token, components, index_);
+                        } else if (token.size() > 1 && (token[0] == '+' || token[0] == '-')) {
+                            catalog.insert(std::string_view{token}.substr(1), token[0] == '+' ? added : removed, index_);
+                        } else {
+                            throw std::invalid_argument{"Line " + std::to_string(line_number) + ": expected +component or -component, got \"" + token + "\""};
+                        }
+                    }
+                    if (components.size() == 0) {
+                        if (change) {
+                            throw std::invalid_argument{"Line " + std::to_string(line_number) + ": transition without archetype"};
+                        }
+                        continue;
+                    }
+
+                    auto* base = ensure_archetype(components);
+                    if (!change) {
+                        continue;
+                    }
+                    tmp_change_.clear();
+                    for (const auto& meta : added) {
+                        components.insert(meta);
+                        tmp_change_.insert(meta.id * 2U);
+                    }
+                    for (const auto& meta : removed) {
+                        components.erase(meta.id);
+                        tmp_change_.insert(meta.id * 2U + 1U);
+                    }
+                    base->cache_transition(tmp_change_, ensure_archetype(std::move(components)));
+                }
+                return size() - archetypes;
             }
 
             /// @brief Returns iterator to the beginning of archetypes container
@@ -262,14 +741,77 @@ namespace ecs {
                 return archetypes_.size();
             }
 
+            /// @brief Returns the storage chunk buffers are allocated from
+            ///
+            /// @return block_storage&
+            [[nodiscard]] block_storage& storage() const noexcept {
+                return *block_storage_;
+            }
+
+            /// @brief Returns the index mapping component types to the dense IDs used by this registry
+            ///
+            /// @return component_index&
+            [[nodiscard]] component_index& components() noexcept {
+                return index_;
+            }
+
+            [[nodiscard]] const component_index& components() const noexcept {
+                return index_;
+            }
+
+            /// @brief Current change version. Chunk columns written from now on are stamped with it
+            /// until advance_version() is called.
+            ///
+            /// @return std::uint64_t
+            [[nodiscard]] std::uint64_t version() const noexcept {
+                return version_;
+            }
+
+            /// @brief Start a new change version, e.g. after a system ran
+            ///
+            /// @return std::uint64_t the new version
+            std::uint64_t advance_version() noexcept {
+                return ++version_;
+            }
+
 
         private:
 
-            static decltype(auto) create_archetype(auto&& components_meta) {
-                return std::make_unique<ecs::archetype>(std::forward<decltype(components_meta)>(components_meta));
+            /// @brief Create the archetype before inserting it, a failing chunk allocation leaves the
+            /// container untouched
+            /// @param components_meta components of the archetype
+            /// @param hash hash of the component set, computed by the failed lookup
+            archetype* insert_archetype(component_meta_set components_meta, std::size_t hash) {
+                auto archetype = create_archetype(std::move(components_meta));
+                auto components = archetype->components().ids();
+                return archetypes_.emplace_with_hash(hash, std::move(components), std::move(archetype)).first->second.get();
+            }
+
+            /// @brief Encode adding or removing component T into a transition key, bit 2 * id marks
+            /// an added and bit 2 * id + 1 a removed component
+            template<component T>
+            void insert_change(component_set& change, bool removed) {
+                change.insert(index_.id<T>() * 2U + removed);
+                if constexpr (enableable_component<T>) {
+                    change.insert(index_.id<enabled_flag<T>>() * 2U + removed);
+                }
+            }
+
+            std::unique_ptr<ecs::archetype> create_archetype(component_meta_set components_meta) {
+                auto archetype = std::make_unique<ecs::archetype>(std::move(components_meta), index_, *block_storage_,
+                    small_chunks_ ? &small_storage_ : nullptr, &version_);
+                archetype->reserve(reserved_chunks_);
+                return archetype;
             }
 
+            component_index index_{};
+            block_storage* block_storage_{};
+            small_block_storage small_storage_;
+            bool small_chunks_{};
+            std::size_t reserved_chunks_{};
             component_set tmp_component_set_{};
+            component_set tmp_change_{};
+            std::uint64_t version_{1};
             storage_type_t archetypes_{};
     };
 
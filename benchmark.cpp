@@ -0,0 +1,117 @@
+// Read mostly lookup table benchmark: ecs::concurrent_hash_map against ecs::hash_map behind a std::mutex.
+//
+//     g++ -std=c++20 -O2 -pthread benchmark.cpp -o benchmark && ./benchmark [ops per thread] [write percent]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "concurrent_hash_map.hpp"
+#include "hash_map.hpp"
+
+namespace {
+
+    constexpr std::uint64_t key_count = 1U << 16U;
+
+    /// @brief ecs::hash_map guarded by a single mutex, the baseline
+    class locked_hash_map {
+
+        public:
+
+            [[nodiscard]] bool find(std::uint64_t key) const {
+                std::lock_guard lock{mutex_};
+                return map_.find(key) != map_.end();
+            }
+
+            void insert_or_assign(std::uint64_t key, std::uint64_t value) {
+                std::lock_guard lock{mutex_};
+                map_.insert_or_assign({key, value});
+            }
+
+        private:
+            mutable std::mutex mutex_;
+            ecs::hash_map<std::uint64_t, std::uint64_t> map_;
+    };
+
+    struct concurrent_adapter {
+        [[nodiscard]] bool find(std::uint64_t key) const {
+            return map.find(key).has_value();
+        }
+
+        void insert_or_assign(std::uint64_t key, std::uint64_t value) {
+            map.insert_or_assign(key, value);
+        }
+
+        ecs::concurrent_hash_map<std::uint64_t, std::uint64_t> map{64};
+    };
+
+    /// @brief xorshift64, cheap enough to not dominate the measured operations
+    std::uint64_t next_random(std::uint64_t& state) noexcept {
+        state ^= state << 13U;
+        state ^= state >> 7U;
+        state ^= state << 17U;
+        return state;
+    }
+
+    /// @brief Run ops_per_thread operations on each of thread_count threads
+    /// @return million operations per second
+    template<typename Map>
+    double run(Map& map, std::size_t thread_count, std::size_t ops_per_thread, std::uint64_t write_percent) {
+        std::vector<std::thread> threads;
+        std::atomic<std::size_t> hits{};
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t] {
+                std::uint64_t state = 0x9e3779b97f4a7c15ULL * (t + 1);
+                std::size_t local_hits = 0;
+                for (std::size_t i = 0; i < ops_per_thread; ++i) {
+                    const auto random = next_random(state);
+                    const auto key = random % (key_count * 2);
+                    if ((random >> 32U) % 100 < write_percent) {
+                        map.insert_or_assign(key, random);
+                    } else {
+                        local_hits += map.find(key);
+                    }
+                }
+                hits += local_hits;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(thread_count * ops_per_thread) / elapsed.count() / 1e6;
+    }
+
+    template<typename Map>
+    void populate(Map& map) {
+        for (std::uint64_t key = 0; key < key_count * 2; key += 2) {
+            map.insert_or_assign(key, key);
+        }
+    }
+
+}
+
+int main(int argc, char** argv) {
+    const std::size_t ops_per_thread = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    const std::uint64_t write_percent = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+
+    std::printf("%zu ops per thread, %llu%% writes, Mops/s\n", ops_per_thread,
+        static_cast<unsigned long long>(write_percent));
+    std::printf("%8s %14s %14s\n", "threads", "mutex", "concurrent");
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        locked_hash_map locked;
+        concurrent_adapter concurrent;
+        populate(locked);
+        populate(concurrent);
+        const double locked_rate = run(locked, threads, ops_per_thread, write_percent);
+        const double concurrent_rate = run(concurrent, threads, ops_per_thread, write_percent);
+        std::printf("%8zu %14.2f %14.2f\n", threads, locked_rate, concurrent_rate);
+    }
+    return 0;
+}
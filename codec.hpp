@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <limits>
+#include <vector>
+
+namespace ecs::codec {
+
+    /// @brief Transpose count elements of elem_size bytes so that byte k of every element is stored
+    /// contiguously: |a0 b0 c0|a1 b1 c1| => |a0 a1|b0 b1|c0 c1|. Columns of similar values turn into
+    /// long runs which the LZ stage below compresses well.
+    ///
+    /// @param src Source elements
+    /// @param dst Destination, must not overlap src
+    /// @param count Number of elements
+    /// @param elem_size Size of a single element
+    inline void shuffle(const std::byte* src, std::byte* dst, std::size_t count, std::size_t elem_size) noexcept {
+        for (std::size_t b = 0; b < elem_size; ++b) {
+            for (std::size_t i = 0; i < count; ++i) {
+                dst[b * count + i] = src[i * elem_size + b];
+            }
+        }
+    }
+
+    /// @brief Inverse of shuffle()
+    ///
+    /// @param src Shuffled bytes
+    /// @param dst Destination elements, must not overlap src
+    /// @param count Number of elements
+    /// @param elem_size Size of a single element
+    inline void unshuffle(const std::byte* src, std::byte* dst, std::size_t count, std::size_t elem_size) noexcept {
+        for (std::size_t b = 0; b < elem_size; ++b) {
+            for (std::size_t i = 0; i < count; ++i) {
+                dst[i * elem_size + b] = src[b * count + i];
+            }
+        }
+    }
+
+    namespace detail {
+
+        inline void put_varint(std::vector<std::byte>& out, std::size_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<std::byte>(value | 0x80));
+                value >>= 7U;
+            }
+            out.push_back(static_cast<std::byte>(value));
+        }
+
+        inline std::size_t get_varint(const std::byte*& in) noexcept {
+            std::size_t value = 0;
+            for (std::size_t shift = 0;; shift += 7) {
+                const auto b = static_cast<std::size_t>(*in++);
+                value |= (b & 0x7FU) << shift;
+                if (b < 0x80) {
+                    return value;
+                }
+            }
+        }
+
+        inline std::uint32_t load32(const std::byte* ptr) noexcept {
+            std::uint32_t v;
+            std::memcpy(&v, ptr, sizeof(v));
+            return v;
+        }
+    }
+
+    /// @brief LZ77 style compression. The stream is a sequence of
+    /// |literal count|literals|match length|match offset| records, the last record has a match
+    /// length of zero and no offset. Counts and lengths are varints, offsets are 16 bit.
+    ///
+    /// @param src Input bytes
+    /// @param size Input size
+    /// @param out Output, compressed bytes are appended
+    inline void compress(const std::byte* src, std::size_t size, std::vector<std::byte>& out) {
+        constexpr std::size_t min_match = 4;
+        constexpr std::size_t hash_bits = 12;
+        constexpr std::size_t max_offset = std::numeric_limits<std::uint16_t>::max();
+        constexpr auto empty = std::numeric_limits<std::uint32_t>::max();
+
+        std::array<std::uint32_t, std::size_t{ 1 } << hash_bits> table;
+        table.fill(empty);
+
+        std::size_t anchor = 0;
+        std::size_t i = 0;
+
+        auto emit = [&](std::size_t literal_end, std::size_t match_length, std::size_t offset) {
+            detail::put_varint(out, literal_end - anchor);
+            out.insert(out.end(), src + anchor, src + literal_end);
+            detail::put_varint(out, match_length);
+            if (match_length != 0) {
+                out.push_back(static_cast<std::byte>(offset & 0xFFU));
+                out.push_back(static_cast<std::byte>(offset >> 8U));
+            }
+        };
+
+        while (i + min_match <= size) {
+            const auto sequence = detail::load32(src + i);
+            const auto h = (sequence * 2654435761U) >> (32U - hash_bits);
+            const auto candidate = table[h];
+            table[h] = static_cast<std::uint32_t>(i);
+
+            if (candidate == empty || i - candidate > max_offset || detail::load32(src + candidate) != sequence) {
+                ++i;
+                continue;
+            }
+
+            std::size_t length = min_match;
+            while (i + length < size && src[candidate + length] == src[i + length]) {
+                ++length;
+            }
+            emit(i, length, i - candidate);
+            i += length;
+            anchor = i;
+        }
+        emit(size, 0, 0);
+    }
+
+    /// @brief Decompress a stream produced by compress()
+    ///
+    /// @param src Compressed bytes
+    /// @param size Compressed size
+    /// @param dst Destination, must be large enough for the uncompressed data
+    /// @return std::size_t Number of bytes written
+    inline std::size_t decompress(const std::byte* src, std::size_t size, std::byte* dst) noexcept {
+        const std::byte* in = src;
+        const std::byte* end = src + size;
+        std::byte* out = dst;
+        while (in < end) {
+            const auto literals = detail::get_varint(in);
+            std::memcpy(out, in, literals);
+            in += literals;
+            out += literals;
+
+            const auto length = detail::get_varint(in);
+            if (length == 0) {
+                break;
+            }
+            const auto offset = static_cast<std::size_t>(in[0]) | (static_cast<std::size_t>(in[1]) << 8U);
+            in += 2;
+            // byte wise copy, source and destination may overlap for runs
+            const std::byte* match = out - offset;
+            for (std::size_t k = 0; k < length; ++k) {
+                out[k] = match[k];
+            }
+            out += length;
+        }
+        return static_cast<std::size_t>(out - dst);
+    }
+
+}
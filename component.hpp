@@ -1,8 +1,17 @@
 #pragma once
 
+#include <array>
+#include <bit>
 #include <concepts>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
 #include <vector>
 
+#include "entity.hpp"
 #include "hash_map.hpp"
 #include "dynamic_bitset.hpp"
 
@@ -27,6 +36,174 @@ namespace ecs {
     template<typename T>
     constexpr static std::string_view type_name() noexcept { return typeid(T).name(); }
 
+    /// @brief Base for flag-like components. Components deriving from flag (and adding no members)
+    /// are stored as one bit per entity instead of a bool:
+    /// struct frozen : ecs::flag {};
+    struct flag {
+        bool value{};
+    };
+
+    /// @brief Trait selecting the AoSoA layout for a component whose members all have type
+    /// scalar_type. Its column is split into blocks of `lanes` entities and inside a block every
+    /// member is stored as `lanes` consecutive scalars:
+    /// |x0..x7|y0..y7|z0..z7|x8..x15|y8..y15|z8..z15|...
+    /// so every member of 8 (or 16) entities loads as one aligned SIMD register. Specialize to opt in:
+    /// template<> struct ecs::lane_layout<vec3> { using scalar_type = float; static constexpr std::size_t lanes = 8; };
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    struct lane_layout {
+        using scalar_type = void;
+        static constexpr std::size_t lanes = 0;
+    };
+
+    /// @brief Lane component concept. Lane components are stored in lane_blocks and are accessed
+    /// through lane_reference instead of a real reference
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    concept lane_component = std::is_class_v<T> && (lane_layout<T>::lanes > 0)
+        && std::has_single_bit(lane_layout<T>::lanes * sizeof(typename lane_layout<T>::scalar_type))
+        && std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>
+        && sizeof(T) % sizeof(typename lane_layout<T>::scalar_type) == 0;
+
+    /// @brief Block of `lanes` lane components, data[f][l] is member f of entity l of the block
+    ///
+    /// @tparam T Lane component type
+    template<lane_component T>
+    struct lane_block {
+        using scalar_type = typename lane_layout<T>::scalar_type;
+
+        static constexpr std::size_t lanes = lane_layout<T>::lanes;
+        static constexpr std::size_t fields = sizeof(T) / sizeof(scalar_type);
+
+        /// @brief Read the component of a lane
+        [[nodiscard]] T load(std::size_t lane) const noexcept {
+            std::array<scalar_type, fields> values;
+            for (std::size_t f = 0; f < fields; ++f) {
+                values[f] = data[f][lane];
+            }
+            T value;
+            std::memcpy(&value, values.data(), sizeof(T));
+            return value;
+        }
+
+        /// @brief Write the component of a lane
+        void store(std::size_t lane, const T& value) noexcept {
+            std::array<scalar_type, fields> values;
+            std::memcpy(values.data(), &value, sizeof(T));
+            for (std::size_t f = 0; f < fields; ++f) {
+                data[f][lane] = values[f];
+            }
+        }
+
+        alignas(lanes * sizeof(scalar_type)) scalar_type data[fields][lanes];
+    };
+
+    /// @brief Trait listing the members of a component that is split member wise. Every member gets
+    /// its own sub-column, so a column of transform{pos, rot, scale} is stored as
+    /// |pos|pos|pos|...|rot|rot|rot|...|scale|scale|scale|...
+    /// and code reading only pos touches no rot or scale bytes. Specialize to opt in:
+    /// template<> struct ecs::split_members<transform> {
+    ///     static constexpr auto members = std::tuple{ &transform::pos, &transform::rot, &transform::scale };
+    /// };
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    struct split_members {};
+
+    /// @brief Split component concept. Split components are accessed through field_reference
+    /// instead of a real reference
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    concept split_component = std::is_class_v<T> && requires { split_members<T>::members; }
+        && std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T> && !lane_component<T>
+        && !std::is_base_of_v<flag, T>;
+
+    namespace detail {
+
+        template<typename M>
+        struct member_pointer_traits;
+
+        template<typename C, typename F>
+        struct member_pointer_traits<F C::*> {
+            using class_type = C;
+            using field_type = F;
+        };
+
+        constexpr std::size_t align_up(std::size_t offset, std::size_t align) noexcept {
+            return (offset + align - 1U) & ~(align - 1U);
+        }
+    }
+
+    /// @brief Layout of a split component column with room for capacity entities
+    ///
+    /// @tparam T Split component type
+    template<split_component T>
+    struct split_column {
+        static constexpr auto members = split_members<T>::members;
+        static constexpr std::size_t fields = std::tuple_size_v<std::remove_cvref_t<decltype(members)>>;
+
+        template<std::size_t I>
+        using field_type = typename detail::member_pointer_traits<std::remove_cvref_t<decltype(std::get<I>(members))>>::field_type;
+
+        /// @brief Offset of the sub-column of member I
+        template<std::size_t I>
+        static constexpr std::size_t offset(std::size_t capacity) noexcept {
+            std::size_t end = 0;
+            [&]<std::size_t... J>(std::index_sequence<J...>) {
+                ((end = detail::align_up(end, alignof(field_type<J>)) + capacity * sizeof(field_type<J>)), ...);
+            }(std::make_index_sequence<I>{});
+            return detail::align_up(end, alignof(field_type<I>));
+        }
+
+        /// @brief Size of the whole column
+        static constexpr std::size_t size(std::size_t capacity) noexcept {
+            return offset<fields - 1>(capacity) + capacity * sizeof(field_type<fields - 1>);
+        }
+
+        /// @brief Index of the member Member points to
+        template<auto Member>
+        static constexpr std::size_t index_of() noexcept {
+            std::size_t index = fields;
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                auto match = [&]<std::size_t J>() {
+                    if constexpr (std::is_same_v<std::remove_cvref_t<decltype(std::get<J>(members))>, decltype(Member)>) {
+                        if (std::get<J>(members) == Member) {
+                            index = J;
+                        }
+                    }
+                };
+                (match.template operator()<I>(), ...);
+            }(std::make_index_sequence<fields>{});
+            return index;
+        }
+
+        /// @brief Sub-column of member I
+        template<std::size_t I, typename Byte>
+        static auto field(Byte* column, std::size_t capacity) noexcept {
+            using pointer = std::conditional_t<std::is_const_v<Byte>, const field_type<I>*, field_type<I>*>;
+            return reinterpret_cast<pointer>(column + offset<I>(capacity));
+        }
+
+        /// @brief Gather the members of an entity
+        static T load(const std::byte* column, std::size_t capacity, std::size_t index) noexcept {
+            T value{};
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((value.*std::get<I>(members) = field<I>(column, capacity)[index]), ...);
+            }(std::make_index_sequence<fields>{});
+            return value;
+        }
+
+        /// @brief Scatter the members of an entity
+        static void store(std::byte* column, std::size_t capacity, std::size_t index, const T& value) noexcept {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((field<I>(column, capacity)[index] = value.*std::get<I>(members)), ...);
+            }(std::make_index_sequence<fields>{});
+        }
+    };
+
     template<typename = void, typename _id_type = std::uint64_t>
     class type_registry {
         public:
@@ -101,6 +278,29 @@ namespace ecs {
             static_cast<T*>(ptr)->~T();
         }
 
+        /// @brief Element copy callback for lane and split components T, whose elements are spread
+        /// over their column
+        ///
+        /// @tparam T Target type
+        /// @param dst Column to copy to
+        /// @param dst_capacity Capacity of the dst column
+        /// @param dst_index Index of the entity in dst
+        /// @param src Column to copy from
+        /// @param src_capacity Capacity of the src column
+        /// @param src_index Index of the entity in src
+        template<typename T>
+        static void element_copier(void* dst, std::size_t dst_capacity, std::size_t dst_index,
+            const void* src, std::size_t src_capacity, std::size_t src_index) {
+            if constexpr (lane_component<T>) {
+                constexpr auto lanes = lane_block<T>::lanes;
+                const auto& from = static_cast<const lane_block<T>*>(src)[src_index / lanes];
+                static_cast<lane_block<T>*>(dst)[dst_index / lanes].store(dst_index % lanes, from.load(src_index % lanes));
+            } else if constexpr (split_component<T>) {
+                split_column<T>::store(static_cast<std::byte*>(dst), dst_capacity, dst_index,
+                    split_column<T>::load(static_cast<const std::byte*>(src), src_capacity, src_index));
+            }
+        }
+
         /// @brief Constructs meta_t for type T
         ///
         /// @tparam T Target type
@@ -114,6 +314,12 @@ namespace ecs {
                 &move_constructor<T>,
                 &move_assignment<T>,
                 &destructor<T>,
+                std::is_trivially_copyable_v<T>,
+                std::is_base_of_v<flag, T> && sizeof(T) == sizeof(flag),
+                lanes_of<T>(),
+                lane_align_of<T>(),
+                split_size_of<T>(),
+                &element_copier<T>,
             };
             return &meta;
         }
@@ -124,6 +330,48 @@ namespace ecs {
         void (*move_construct)(void*, void*) = [](void*, void*) -> void {};
         void (*move_assign)(void*, void*) = [](void*, void*) -> void {};
         void (*destruct)(void*) = [](void*) -> void {};
+        bool trivially_copyable = false;
+        bool bit_packed = false;
+        std::size_t lanes = 0;
+        std::size_t lane_align = 0;
+        std::size_t (*split_size)(std::size_t) = nullptr;
+        void (*element_copy)(void*, std::size_t, std::size_t, const void*, std::size_t, std::size_t) =
+            [](void*, std::size_t, std::size_t, const void*, std::size_t, std::size_t) -> void {};
+
+        /// @brief Whether elements of the column are not stored as contiguous objects
+        [[nodiscard]] constexpr bool scattered() const noexcept {
+            return lanes != 0 || split_size != nullptr;
+        }
+
+        /// @brief Lanes per block of T, 0 if T is not a lane component
+        template<typename T>
+        static constexpr std::size_t lanes_of() noexcept {
+            if constexpr (lane_component<T>) {
+                return lane_layout<T>::lanes;
+            } else {
+                return 0;
+            }
+        }
+
+        /// @brief Column size callback of T if it is a split component
+        template<typename T>
+        static constexpr auto split_size_of() noexcept -> std::size_t (*)(std::size_t) {
+            if constexpr (split_component<T>) {
+                return &split_column<T>::size;
+            } else {
+                return nullptr;
+            }
+        }
+
+        /// @brief Column alignment of T if it is a lane component
+        template<typename T>
+        static constexpr std::size_t lane_align_of() noexcept {
+            if constexpr (lane_component<T>) {
+                return alignof(lane_block<T>);
+            } else {
+                return 0;
+            }
+        }
     };
 
     /// @brief Type for component ID
@@ -139,6 +387,168 @@ namespace ecs {
     template<typename T>
     concept component = std::is_class_v<T> && std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>;
 
+    /// @brief Flag component concept. Flag components are stored bit packed, one bit per entity, and
+    /// are accessed through bit_reference instead of a real reference
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    concept flag_component = component<T> && std::is_base_of_v<flag, T> && sizeof(T) == sizeof(flag);
+
+    /// @brief Trait marking components that can be toggled per entity without moving it to another
+    /// archetype. Specialize to opt in:
+    /// template<> struct ecs::enableable<visible> : std::true_type {};
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    struct enableable : std::false_type {};
+
+    /// @brief Enableable component concept
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    concept enableable_component = component<T> && enableable<T>::value;
+
+    /// @brief Hidden flag column holding the enable bit of component T for every row
+    ///
+    /// @tparam T Enableable component type
+    template<component T>
+    struct enabled_flag : flag {};
+
+    /// @brief Proxy reference to a single bit of a flag component column
+    ///
+    /// @tparam C Flag component type
+    /// @tparam is_const Whether the referenced bit is read-only
+    template<typename C, bool is_const>
+    class bit_reference {
+        public:
+            using word_type = std::conditional_t<is_const, const std::uint64_t, std::uint64_t>;
+
+            constexpr bit_reference(word_type* word, std::uint64_t mask) noexcept : word_(word), mask_(mask) {}
+
+            constexpr bit_reference(const bit_reference& rhs) noexcept = default;
+
+            /// @brief Read the flag
+            [[nodiscard]] constexpr bool value() const noexcept {
+                return (*word_ & mask_) != 0;
+            }
+
+            constexpr operator bool() const noexcept {
+                return value();
+            }
+
+            constexpr operator C() const noexcept {
+                C c{};
+                c.value = value();
+                return c;
+            }
+
+            /// @brief Write the flag
+            constexpr const bit_reference& operator=(bool value) const noexcept requires(!is_const) {
+                *word_ = value ? (*word_ | mask_) : (*word_ & ~mask_);
+                return *this;
+            }
+
+            constexpr const bit_reference& operator=(const C& c) const noexcept requires(!is_const) {
+                return *this = c.value;
+            }
+
+            constexpr const bit_reference& operator=(const bit_reference& rhs) const noexcept requires(!is_const) {
+                return *this = rhs.value();
+            }
+
+        private:
+            word_type* word_;
+            std::uint64_t mask_;
+    };
+
+    /// @brief Proxy reference to a lane component, reads gather and writes scatter the members of
+    /// the entity inside its lane_block
+    ///
+    /// @tparam C Lane component type
+    /// @tparam is_const Whether the referenced component is read-only
+    template<typename C, bool is_const>
+    class lane_reference {
+        public:
+            using block_type = std::conditional_t<is_const, const lane_block<C>, lane_block<C>>;
+
+            constexpr lane_reference(block_type* block, std::size_t lane) noexcept : block_(block), lane_(lane) {}
+
+            constexpr lane_reference(const lane_reference& rhs) noexcept = default;
+
+            /// @brief Read the component
+            [[nodiscard]] C get() const noexcept {
+                return block_->load(lane_);
+            }
+
+            operator C() const noexcept {
+                return get();
+            }
+
+            /// @brief Write the component
+            const lane_reference& operator=(const C& value) const noexcept requires(!is_const) {
+                block_->store(lane_, value);
+                return *this;
+            }
+
+            const lane_reference& operator=(const lane_reference& rhs) const noexcept requires(!is_const) {
+                return *this = rhs.get();
+            }
+
+        private:
+            block_type* block_;
+            std::size_t lane_;
+    };
+
+    /// @brief Proxy reference to a split component. Whole component reads gather and writes scatter
+    /// its members, field<&C::member>() is a real reference into the member's sub-column.
+    ///
+    /// @tparam C Split component type
+    /// @tparam is_const Whether the referenced component is read-only
+    template<typename C, bool is_const>
+    class field_reference {
+        public:
+            using byte_type = std::conditional_t<is_const, const std::byte, std::byte>;
+
+            constexpr field_reference(byte_type* column, std::size_t capacity, std::size_t index) noexcept
+                : column_(column), capacity_(capacity), index_(index) {}
+
+            constexpr field_reference(const field_reference& rhs) noexcept = default;
+
+            /// @brief Reference to a single member
+            ///
+            /// @tparam Member Pointer to the member, e.g. &transform::pos
+            template<auto Member>
+            [[nodiscard]] auto& field() const noexcept {
+                constexpr auto index = split_column<C>::template index_of<Member>();
+                static_assert(index < split_column<C>::fields, "Member is not listed in split_members");
+                return split_column<C>::template field<index>(column_, capacity_)[index_];
+            }
+
+            /// @brief Read the component
+            [[nodiscard]] C get() const noexcept {
+                return split_column<C>::load(column_, capacity_, index_);
+            }
+
+            operator C() const noexcept {
+                return get();
+            }
+
+            /// @brief Write the component
+            const field_reference& operator=(const C& value) const noexcept requires(!is_const) {
+                split_column<C>::store(column_, capacity_, index_, value);
+                return *this;
+            }
+
+            const field_reference& operator=(const field_reference& rhs) const noexcept requires(!is_const) {
+                return *this = rhs.get();
+            }
+
+        private:
+            byte_type* column_;
+            std::size_t capacity_;
+            std::size_t index_;
+    };
+
     /// @brief concept of a reference or const reference to C, where C satisfies component concept
     /// @tparam T Component reference type
     template<typename T>
@@ -158,6 +568,40 @@ namespace ecs {
     template<component_reference T>
     constexpr bool const_component_reference_v = const_component_reference<T>::value;
 
+    /// @brief Type returned when accessing component reference T, T itself for regular components, a
+    /// bit_reference for flag components, a lane_reference for lane components and a
+    /// field_reference for split components
+    ///
+    /// @tparam T component_reference type
+    template<component_reference T>
+    struct component_reference_type {
+        using type = T;
+    };
+
+    template<component_reference T>
+        requires flag_component<std::remove_cvref_t<T>>
+    struct component_reference_type<T> {
+        using type = bit_reference<std::remove_cvref_t<T>, const_component_reference_v<T>>;
+    };
+
+    template<component_reference T>
+        requires lane_component<std::remove_cvref_t<T>>
+    struct component_reference_type<T> {
+        using type = lane_reference<std::remove_cvref_t<T>, const_component_reference_v<T>>;
+    };
+
+    template<component_reference T>
+        requires split_component<std::remove_cvref_t<T>>
+    struct component_reference_type<T> {
+        using type = field_reference<std::remove_cvref_t<T>, const_component_reference_v<T>>;
+    };
+
+    /// @brief Returns what accessing component reference T yields
+    ///
+    /// @tparam T component_reference type
+    template<component_reference T>
+    using component_reference_t = typename component_reference_type<T>::type;
+
     /// @brief Struct to determine mutability of component reference type
     ///
     /// @tparam T component reference type
@@ -186,20 +630,91 @@ namespace ecs {
     template<component_reference... Args>
     constexpr bool const_component_references_v = const_component_references<Args...>::value;
 
+    /// @brief Maps process wide component IDs to dense IDs local to one registry. IDs are assigned on
+    /// first use, so bitsets, hashes and sparse maps keyed by component ID stay proportional to the
+    /// number of components a registry actually uses instead of the number of component types in the
+    /// binary. The entity column always has local ID 0.
+    class component_index {
+        public:
+            /// @brief Returned by find() for components that have no local ID yet
+            static constexpr component_id_t invalid_id = std::numeric_limits<component_id_t>::max();
+
+            /// @brief Local ID of the entity column
+            static constexpr component_id_t entity_id = 0;
+
+            component_index() {
+                id<entity>();
+            }
+
+            /// @brief Get or assign the local ID of component T
+            ///
+            /// @tparam T Component type
+            /// @return component_id_t Local ID
+            template<component T>
+            component_id_t id() {
+                return id(component_id::value<T>);
+            }
+
+            /// @brief Get or assign the local ID of a process wide component ID
+            ///
+            /// @param global Process wide component ID
+            /// @return component_id_t Local ID
+            component_id_t id(component_id_t global) {
+                if (global >= local_ids_.size()) {
+                    local_ids_.resize(global + 1, invalid_id);
+                }
+                auto& local = local_ids_[global];
+                if (local == invalid_id) {
+                    local = next_id_++;
+                }
+                return local;
+            }
+
+            /// @brief Get the local ID of component T without assigning one
+            ///
+            /// @tparam T Component type
+            /// @return component_id_t Local ID or invalid_id
+            template<component T>
+            [[nodiscard]] component_id_t find() const noexcept {
+                const auto global = component_id::value<T>;
+                return global < local_ids_.size() ? local_ids_[global] : invalid_id;
+            }
+
+            /// @brief Number of local IDs assigned so far
+            [[nodiscard]] std::size_t size() const noexcept {
+                return next_id_;
+            }
+
+        private:
+            std::vector<component_id_t> local_ids_{};
+            component_id_t next_id_{};
+    };
+
     /// @brief Component metadata. Stores an ID, size, alignment, destructor, etc.
     struct component_meta {
         /// @brief Constructs component_meta for type T
         ///
         /// @tparam T Component type
+        /// @param index Registry component index the ID is taken from
         /// @return component_meta Component metadata
         template<component T>
-        static component_meta of() noexcept {
+        static component_meta of(component_index& index) {
             return component_meta{
-                component_id::value<T>,
+                index.id<T>(),
                 meta_t::of<T>(),
             };
         }
 
+        /// @brief Metadata of the entity column
+        ///
+        /// @return component_meta Entity metadata
+        static component_meta of_entity() noexcept {
+            return component_meta{
+                component_index::entity_id,
+                meta_t::of<entity>(),
+            };
+        }
+
         /// @brief Spaceship operator
         ///
         /// @param rhs Right hand side
@@ -221,6 +736,32 @@ namespace ecs {
         const meta_t* type;
     };
 
+    /// @brief Bytes a column of count components occupies. Flag columns are packed into 64 bit words.
+    ///
+    /// @param meta Component metadata
+    /// @param count Number of components
+    /// @return std::size_t Column size in bytes
+    constexpr std::size_t column_size(const component_meta& meta, std::size_t count) noexcept {
+        if (meta.type->lanes != 0) {
+            return (count + meta.type->lanes - 1U) / meta.type->lanes * meta.type->lanes * meta.type->size;
+        }
+        if (meta.type->split_size != nullptr) {
+            return meta.type->split_size(count);
+        }
+        return meta.type->bit_packed ? (count + 63U) / 64U * sizeof(std::uint64_t) : count * meta.type->size;
+    }
+
+    /// @brief Alignment of a column of components
+    ///
+    /// @param meta Component metadata
+    /// @return std::size_t Column alignment
+    constexpr std::size_t column_align(const component_meta& meta) noexcept {
+        if (meta.type->lanes != 0) {
+            return meta.type->lane_align;
+        }
+        return meta.type->bit_packed ? alignof(std::uint64_t) : meta.type->align;
+    }
+
     /// @brief Component set stores set of component ID's
     class component_set {
         public:
@@ -229,36 +770,45 @@ namespace ecs {
             /// @tparam Args Components type parameter pack
             /// @return component_set Component set
             template<component... Args>
-            static component_set create() {
+            static component_set create(component_index& index) {
                 component_set s;
-                (..., s.insert<Args>());
+                (..., s.insert<Args>(index));
                 return s;
             }
 
             /// @brief Insert component of type T
             ///
             /// @tparam T Component type
+            /// @param index Registry component index
             template<component T>
-            void insert() {
-                insert(component_id::value<T>);
+            void insert(component_index& index) {
+                insert(index.id<T>());
+                if constexpr (enableable_component<T>) {
+                    insert(index.id<enabled_flag<T>>());
+                }
             }
 
             /// @brief Erase component of type T
             ///
             /// @tparam T Component type
+            /// @param index Registry component index
             template<component T>
-            void erase() {
-                erase(component_id::value<T>);
+            void erase(const component_index& index) {
+                erase(index.find<T>());
+                if constexpr (enableable_component<T>) {
+                    erase(index.find<enabled_flag<T>>());
+                }
             }
 
             /// @brief Check if component of type T is present in the set
             ///
             /// @tparam T Component type
+            /// @param index Registry component index
             /// @return true When component type T is present
             /// @return false When component type T is not present
             template<component T>
-            [[nodiscard]] bool contains() const {
-                return contains(component_id::value<T>);
+            [[nodiscard]] bool contains(const component_index& index) const {
+                return contains(index.find<T>());
             }
 
             /// @brief Inserts component into the set
@@ -322,37 +872,46 @@ namespace ecs {
             /// @tparam Args Components type parameter pack
             /// @return component_meta_set Component set
             template<component... Args>
-            static component_meta_set create() {
+            static component_meta_set create(component_index& index) {
                 component_meta_set s;
                 s.components_meta_data_.reserve(sizeof...(Args));
-                (..., s.insert<Args>());
+                (..., s.insert<Args>(index));
                 return s;
             }
 
             /// @brief Insert component of type T
             ///
             /// @tparam T Component type
+            /// @param index Registry component index
             template<component T>
-            void insert() {
-                insert(component_meta::of<T>());
+            void insert(component_index& index) {
+                insert(component_meta::of<T>(index));
+                if constexpr (enableable_component<T>) {
+                    insert(component_meta::of<enabled_flag<T>>(index));
+                }
             }
 
             /// @brief Erase component of type T
             ///
             /// @tparam T Component type
+            /// @param index Registry component index
             template<component T>
-            void erase() {
-                erase(component_id::value<T>);
+            void erase(const component_index& index) {
+                erase(index.find<T>());
+                if constexpr (enableable_component<T>) {
+                    erase(index.find<enabled_flag<T>>());
+                }
             }
 
             /// @brief Check if component of type T is present in the set
             ///
             /// @tparam T Component type
+            /// @param index Registry component index
             /// @return true When component type T is present
             /// @return false When component type T is not present
             template<component T>
-            [[nodiscard]] bool contains() const {
-                return contains(component_id::value<T>);
+            [[nodiscard]] bool contains(const component_index& index) const {
+                return contains(index.find<T>());
             }
 
             /// @brief Inserts component into the set
@@ -441,4 +1000,81 @@ namespace ecs {
             component_set component_set_; //bitmask
             std::vector<component_meta> components_meta_data_;
     };
+
+    /// @brief Maps component names to component types, so archetypes can be declared from data
+    /// files, see registry::declare
+    class component_catalog {
+        public:
+            /// @brief Register component T under name, replacing an earlier registration of the name
+            ///
+            /// @tparam T Component type
+            /// @param name Component name
+            /// @return component_catalog& This catalog
+            template<component T>
+            component_catalog& add(std::string name) {
+                entries_.insert_or_assign({std::move(name), &insert_into<T>});
+                types_.insert_or_assign({std::string{meta_t::of<T>()->name}, &insert_into<T>});
+                return *this;
+            }
+
+            /// @brief Insert the component registered with type name type into a component set, e.g.
+            /// to rebuild an archetype from a storage file
+            ///
+            /// @param type Type name, see meta_t::name
+            /// @param set Component set
+            /// @param index Registry component index
+            /// @return true if a component with that type name is registered
+            bool insert_type(std::string_view type, component_meta_set& set, component_index& index) const {
+                auto iter = types_.find(std::string{type});
+                if (iter == types_.end()) {
+                    return false;
+                }
+                iter->second(set, index);
+                return true;
+            }
+
+            /// @brief Insert the component registered under name into a component set
+            ///
+            /// @param name Component name
+            /// @param set Component set
+            /// @param index Registry component index
+            /// @throws std::invalid_argument if no component is registered under name
+            void insert(std::string_view name, component_meta_set& set, component_index& index) const {
+                auto iter = entries_.find(std::string{name});
+                if (iter == entries_.end()) {
+                    throw std::invalid_argument{"Unknown component \"" + std::string{name} + "\""};
+                }
+                iter->second(set, index);
+            }
+
+            /// @brief Returns the number of registered names
+            ///
+            /// @return std::size_t
+            [[nodiscard]] std::size_t size() const noexcept {
+                return entries_.size();
+            }
+
+        private:
+            using insert_function = void (*)(component_meta_set&, component_index&);
+
+            template<component T>
+            static void insert_into(component_meta_set& set, component_index& index) {
+                set.insert<T>(index);
+            }
+
+            hash_map<std::string, insert_function> entries_{};
+            hash_map<std::string, insert_function> types_{};
+    };
+
+    /// @brief Components added by a structural change, see registry::modify
+    ///
+    /// @tparam Args Component types
+    template<component... Args>
+    struct add {};
+
+    /// @brief Components removed by a structural change, see registry::modify
+    ///
+    /// @tparam Args Component types
+    template<component... Args>
+    struct remove {};
 }
\ No newline at end of file
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "hash_map.hpp"
+
+namespace ecs {
+
+/// @brief Trivially copyable value stored as machine words that are read and written with relaxed atomics, so
+/// that readers racing with a writer get torn copies instead of undefined behavior. Torn copies are discarded by
+/// the sequence lock validation of the reader.
+///
+/// @tparam T Value type
+template<typename T>
+class atomic_words {
+public:
+    using word_type = std::uintptr_t;
+
+    constexpr static std::size_t count = (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+    /// @brief Store value
+    ///
+    /// @param value Value
+    void store(const T& value) noexcept {
+        std::array<word_type, count> buffer{};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+        for (std::size_t i = 0; i < count; i++) {
+            _words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Load value
+    ///
+    /// @return T Value, possibly torn if a writer is active
+    [[nodiscard]] T load() const noexcept {
+        std::array<word_type, count> buffer{};
+        for (std::size_t i = 0; i < count; i++) {
+            buffer[i] = _words[i].load(std::memory_order_relaxed);
+        }
+        std::array<std::byte, sizeof(T)> bytes{};
+        std::memcpy(bytes.data(), buffer.data(), sizeof(T));
+        return std::bit_cast<T>(bytes);
+    }
+
+private:
+    std::array<std::atomic<word_type>, count> _words{};
+};
+
+/// @brief Concurrent hash map for read mostly tables shared between threads.
+///
+/// Keys are spread over a power of two number of shards. Each shard is a robin hood table like hash_table,
+/// guarded by a mutex for writers and a sequence counter for readers:
+///
+///     writer: lock mutex, sequence++ (odd), modify slots, sequence++ (even), unlock
+///     reader: read sequence, probe, retry if the sequence was odd or has changed
+///
+/// so find never blocks and never writes shared memory. Growing a shard builds the new slot array while readers
+/// keep using the old one, then publishes it; replaced arrays are retired and only freed by reclaim() or the
+/// destructor because a reader may still be probing them.
+///
+/// @tparam K Key type, trivially copyable
+/// @tparam T Mapped type, trivially copyable
+/// @tparam Hash Hash type for K
+/// @tparam KeyEqual KeyEqual type for K
+template<typename K, typename T, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+    requires(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<T>)
+class concurrent_hash_map {
+public:
+    using key_type = K;
+    using mapped_type = T;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+
+    constexpr static size_type default_shard_count = 16;
+    constexpr static size_type default_bucket_count = 16; // initial number of buckets of every shard
+
+    /// @brief Construct concurrent hash map
+    ///
+    /// @param shard_count Number of shards, rounded up to a power of two
+    /// @param hash Hash object
+    /// @param equal KeyEqual object
+    explicit concurrent_hash_map(size_type shard_count = default_shard_count,
+        const Hash& hash = Hash(),
+        const KeyEqual& equal = KeyEqual()) :
+        _shards(std::bit_ceil(std::max<size_type>(shard_count, 1))),
+        _hash(hash), _equal(equal) {
+    }
+
+    concurrent_hash_map(const concurrent_hash_map&) = delete;
+    concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+    /// @brief Find key
+    ///
+    /// @param key Key to find
+    /// @return std::optional<mapped_type> Copy of the mapped value, empty if key is not in the map
+    [[nodiscard]] std::optional<mapped_type> find(const key_type& key) const noexcept {
+        const size_type hash = hash_of(key);
+        const shard& owner = shard_of(hash);
+        while (true) {
+            const auto before = owner.sequence.load(std::memory_order_acquire);
+            if (before & 1U) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto result = probe(*owner.current.load(std::memory_order_acquire), hash, key);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (owner.sequence.load(std::memory_order_relaxed) == before) {
+                return result;
+            }
+        }
+    }
+
+    /// @brief Check if key exists in the map
+    ///
+    /// @param key Key to check
+    /// @return true If key exists in the map
+    /// @return false If key does not exist in the map
+    [[nodiscard]] bool contains(const key_type& key) const noexcept {
+        return find(key).has_value();
+    }
+
+    /// @brief Insert key and value if key is not in the map yet
+    ///
+    /// @param key Key
+    /// @param value Mapped value
+    /// @return true If the value was inserted
+    /// @return false If key already existed
+    bool insert(const key_type& key, const mapped_type& value) {
+        return emplace_impl<false>(key, value);
+    }
+
+    /// @brief Insert key and value or assign value to the existing key
+    ///
+    /// @param key Key
+    /// @param value Mapped value
+    /// @return true If the value was inserted
+    /// @return false If an existing value was assigned
+    bool insert_or_assign(const key_type& key, const mapped_type& value) {
+        return emplace_impl<true>(key, value);
+    }
+
+    /// @brief Erase key from the map
+    ///
+    /// @param key Key
+    /// @return true If key was erased
+    /// @return false If key was not in the map
+    bool erase(const key_type& key) {
+        const size_type hash = hash_of(key);
+        shard& owner = shard_of(hash);
+        std::lock_guard lock{ owner.mutex };
+
+        table& slots = *owner.current.load(std::memory_order_relaxed);
+        const size_type bucket_size = slots.size();
+        size_type index = mod_2n(hash, bucket_size);
+        for (size_type probes = 0;; probes++) {
+            const auto dist = slots[index].dist.load(std::memory_order_relaxed);
+            if (dist == 0 || probes >= dist) {
+                return false;
+            }
+            if (slots[index].hash.load(std::memory_order_relaxed) == hash
+                && _equal(slots[index].key.load(), key)) {
+                break;
+            }
+            index = mod_2n(index + 1, bucket_size);
+        }
+
+        begin_write(owner);
+        // backward shift deletion, see hash_table::erase_at
+        while (true) {
+            const size_type next = mod_2n(index + 1, bucket_size);
+            const auto dist = slots[next].dist.load(std::memory_order_relaxed);
+            if (dist <= 1) {
+                break;
+            }
+            copy_slot(slots[next], slots[index]);
+            slots[index].dist.store(dist - 1, std::memory_order_relaxed);
+            index = next;
+        }
+        slots[index].dist.store(0, std::memory_order_relaxed);
+        owner.size.store(owner.size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        end_write(owner);
+        return true;
+    }
+
+    /// @brief Return the number of elements. Only exact while no writer is active.
+    ///
+    /// @return size_type Number of elements
+    [[nodiscard]] size_type size() const noexcept {
+        size_type total = 0;
+        for (const auto& owner : _shards) {
+            total += owner.size.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /// @brief Check if map is empty
+    ///
+    /// @return true If it is empty
+    /// @return false If it is not empty
+    [[nodiscard]] bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    /// @brief Free the slot arrays retired by resizes. Must not run concurrently with any other member function.
+    void reclaim() noexcept {
+        for (auto& owner : _shards) {
+            owner.retired.clear();
+        }
+    }
+
+private:
+    /// @brief Bucket; dist is the probe sequence length plus one, zero for an empty bucket
+    struct slot {
+        std::atomic<std::uint32_t> dist{};
+        std::atomic<size_type> hash{};
+        atomic_words<key_type> key{};
+        atomic_words<mapped_type> value{};
+    };
+
+    using table = std::vector<slot>;
+
+    /// @brief Shard, aligned so that writers of different shards do not share cache lines
+    struct alignas(64) shard {
+        shard() : owned(std::make_unique<table>(default_bucket_count)), current(owned.get()) {
+        }
+
+        std::mutex mutex{};
+        std::atomic<std::uint64_t> sequence{};
+        std::atomic<size_type> size{};
+        std::unique_ptr<table> owned;
+        std::atomic<table*> current;
+        std::vector<std::unique_ptr<table>> retired{};
+    };
+
+    template<bool assign>
+    bool emplace_impl(const key_type& key, const mapped_type& value) {
+        const size_type hash = hash_of(key);
+        shard& owner = shard_of(hash);
+        std::lock_guard lock{ owner.mutex };
+
+        if (auto* existing = locate(*owner.current.load(std::memory_order_relaxed), hash, key)) {
+            if constexpr (assign) {
+                begin_write(owner);
+                existing->value.store(value);
+                end_write(owner);
+            }
+            return false;
+        }
+
+        const size_type count = owner.size.load(std::memory_order_relaxed);
+        if (count + 1 > approx_85_percent(owner.current.load(std::memory_order_relaxed)->size())) {
+            grow(owner);
+        }
+
+        begin_write(owner);
+        place(*owner.current.load(std::memory_order_relaxed), hash, key, value);
+        owner.size.store(count + 1, std::memory_order_relaxed);
+        end_write(owner);
+        return true;
+    }
+
+    /// @brief Rehash the shard into twice as many buckets. The new array is filled before it is published, so
+    /// readers keep probing the unchanged old one meanwhile.
+    void grow(shard& owner) {
+        const table& old_slots = *owner.current.load(std::memory_order_relaxed);
+        auto slots = std::make_unique<table>(old_slots.size() << 1U);
+        for (const auto& entry : old_slots) {
+            if (entry.dist.load(std::memory_order_relaxed) != 0) {
+                place(*slots, entry.hash.load(std::memory_order_relaxed), entry.key.load(), entry.value.load());
+            }
+        }
+        owner.current.store(slots.get(), std::memory_order_release);
+        owner.retired.push_back(std::exchange(owner.owned, std::move(slots)));
+    }
+
+    /// @brief Robin hood insertion of a key known not to be in slots
+    static void place(table& slots, size_type hash, key_type key, mapped_type value) noexcept {
+        const size_type bucket_size = slots.size();
+        size_type index = mod_2n(hash, bucket_size);
+        std::uint32_t dist = 1;
+        while (true) {
+            slot& current = slots[index];
+            const auto current_dist = current.dist.load(std::memory_order_relaxed);
+            if (current_dist == 0) {
+                current.hash.store(hash, std::memory_order_relaxed);
+                current.key.store(key);
+                current.value.store(value);
+                current.dist.store(dist, std::memory_order_relaxed);
+                return;
+            }
+            if (dist > current_dist) {
+                // take the bucket and continue inserting the displaced entry
+                const auto displaced_hash = current.hash.load(std::memory_order_relaxed);
+                const auto displaced_key = current.key.load();
+                const auto displaced_value = current.value.load();
+                current.hash.store(hash, std::memory_order_relaxed);
+                current.key.store(key);
+                current.value.store(value);
+                current.dist.store(dist, std::memory_order_relaxed);
+                hash = displaced_hash;
+                key = displaced_key;
+                value = displaced_value;
+                dist = current_dist;
+            }
+            dist++;
+            index = mod_2n(index + 1, bucket_size);
+        }
+    }
+
+    /// @brief Find the bucket holding key, only called by writers
+    slot* locate(table& slots, size_type hash, const key_type& key) const noexcept {
+        const size_type bucket_size = slots.size();
+        size_type index = mod_2n(hash, bucket_size);
+        for (size_type probes = 0;; probes++) {
+            slot& current = slots[index];
+            const auto dist = current.dist.load(std::memory_order_relaxed);
+            if (dist == 0 || probes >= dist) {
+                return nullptr;
+            }
+            if (current.hash.load(std::memory_order_relaxed) == hash && _equal(current.key.load(), key)) {
+                return &current;
+            }
+            index = mod_2n(index + 1, bucket_size);
+        }
+    }
+
+    /// @brief Reader side probe. Bounded by the bucket count since a torn read can break the probe invariants.
+    std::optional<mapped_type> probe(const table& slots, size_type hash, const key_type& key) const noexcept {
+        const size_type bucket_size = slots.size();
+        size_type index = mod_2n(hash, bucket_size);
+        for (size_type probes = 0; probes < bucket_size; probes++) {
+            const slot& current = slots[index];
+            const auto dist = current.dist.load(std::memory_order_relaxed);
+            if (dist == 0 || probes >= dist) {
+                return std::nullopt;
+            }
+            if (current.hash.load(std::memory_order_relaxed) == hash && _equal(current.key.load(), key)) {
+                return current.value.load();
+            }
+            index = mod_2n(index + 1, bucket_size);
+        }
+        return std::nullopt;
+    }
+
+    static void copy_slot(const slot& from, slot& to) noexcept {
+        to.hash.store(from.hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        to.key.store(from.key.load());
+        to.value.store(from.value.load());
+    }
+
+    static void begin_write(shard& owner) noexcept {
+        owner.sequence.store(owner.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    static void end_write(shard& owner) noexcept {
+        owner.sequence.store(owner.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// @brief Hash key and mix the result, the low bits select the bucket and the high bits the shard
+    [[nodiscard]] size_type hash_of(const key_type& key) const noexcept {
+        // murmur3 finalizer, identity hashes such as std::hash<int> would otherwise put every key in shard 0
+        auto hash = static_cast<std::uint64_t>(_hash(key));
+        hash ^= hash >> 33U;
+        hash *= 0xff51afd7ed558ccdULL; // NOLINT(readability-magic-numbers)
+        hash ^= hash >> 33U;
+        hash *= 0xc4ceb9fe1a85ec53ULL; // NOLINT(readability-magic-numbers)
+        hash ^= hash >> 33U;
+        return static_cast<size_type>(hash);
+    }
+
+    [[nodiscard]] shard& shard_of(size_type hash) noexcept {
+        return _shards[mod_2n(static_cast<std::uint64_t>(hash) >> 48U, _shards.size())];
+    }
+
+    [[nodiscard]] const shard& shard_of(size_type hash) const noexcept {
+        return _shards[mod_2n(static_cast<std::uint64_t>(hash) >> 48U, _shards.size())];
+    }
+
+    std::vector<shard> _shards;
+    hasher _hash{};
+    key_equal _equal{};
+};
+
+}
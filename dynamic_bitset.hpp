@@ -44,6 +44,9 @@ namespace ecs {
             inline dynamic_bitset& set(std::size_t pos, bool value = true) {
                 const auto [block_index, bit_pos] = block_and_bit(pos);
                 if (block_index >= blocks_.size()) {
+                    if (!value) {
+                        return *this;
+                    }
                     blocks_.resize(block_index + 1);
                 }
                 if (value) {
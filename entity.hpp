@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <vector>
 #include <limits>
+#include <utility>
 
 namespace ecs {
 
@@ -77,7 +78,7 @@ namespace ecs {
             ///
             /// @param e Entity to check
             /// @return True if entity is alive
-            [[nodiscard]] bool alive(entity e) {
+            [[nodiscard]] bool alive(entity e) const noexcept {
                 if (e.id() < generations_.size()) {
                     return generations_[e.id()] == e.generation();
                 }
@@ -95,10 +96,76 @@ namespace ecs {
                 freed_ids_.push_back(e.id());
             }
 
+            /// @brief Retire the entity: the handle stops being alive immediately, but its ID is only
+            /// reused after reclaim(), e.g. once the row it still occupies has been compacted away
+            ///
+            /// @param e Entity to retire
+            void retire(entity e) {
+                if(!alive(e)) {
+                    return;
+                }
+                generations_[e.id()] += 1;
+                retired_ids_.push_back(e.id());
+            }
+
+            /// @brief IDs retired since the last reclaim()
+            [[nodiscard]] const std::vector<entity_id_t>& retired() const noexcept {
+                return retired_ids_;
+            }
+
+            /// @brief Make all retired IDs available to create()
+            void reclaim() {
+                freed_ids_.insert(freed_ids_.end(), retired_ids_.begin(), retired_ids_.end());
+                retired_ids_.clear();
+            }
+
+            /// @brief Preallocate room for n entity IDs so create() and recycle() do not allocate
+            /// until more than n IDs are in use
+            ///
+            /// @param n Number of entity IDs
+            void reserve(std::size_t n) {
+                generations_.reserve(n);
+                freed_ids_.reserve(n);
+                retired_ids_.reserve(n);
+            }
+
+            /// @brief Generation of every ID handed out so far, indexed by ID
+            [[nodiscard]] const std::vector<generation_id_t>& generations() const noexcept {
+                return generations_;
+            }
+
+            /// @brief IDs create() hands out again before new ones
+            [[nodiscard]] const std::vector<entity_id_t>& freed() const noexcept {
+                return freed_ids_;
+            }
+
+            /// @brief Replace the pool state with one saved through generations() and freed(), e.g.
+            /// after a restart
+            ///
+            /// @param generations Generation of every ID handed out so far
+            /// @param freed Free IDs, each below generations.size()
+            void restore(std::vector<generation_id_t> generations, std::vector<entity_id_t> freed) {
+                next_id_ = static_cast<entity_id_t>(generations.size());
+                generations_ = std::move(generations);
+                freed_ids_ = std::move(freed);
+                retired_ids_.clear();
+            }
+
+            /// @brief Number of alive entities
+            [[nodiscard]] std::size_t size() const noexcept {
+                return next_id_ - freed_ids_.size() - retired_ids_.size();
+            }
+
+            /// @brief Number of IDs create() cannot hand out, alive or retired
+            [[nodiscard]] std::size_t used() const noexcept {
+                return next_id_ - freed_ids_.size();
+            }
+
         private:
             entity_id_t next_id_ = 0UL;
             std::vector<generation_id_t> generations_;
             std::vector<entity_id_t> freed_ids_;
+            std::vector<entity_id_t> retired_ids_;
     };
 
     class archetype;
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <ranges>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "entity.hpp"
+#include "component.hpp"
+#include "sparse_map.hpp"
+
+namespace ecs {
+
+    /// @brief Trait marking components that are stored in a per type sparse pool instead of the
+    /// archetype chunks. Sparse components are added and removed without moving the entity between
+    /// archetypes and are iterated through owning groups. Specialize to opt in:
+    /// template<> struct ecs::sparse_storage<target> : std::true_type {};
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    struct sparse_storage : std::false_type {};
+
+    /// @brief Sparse component concept
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    concept sparse_component = component<T> && sparse_storage<T>::value && !flag_component<T>;
+
+    /// @brief Component stored in archetype chunks, i.e. any component that is not sparse
+    ///
+    /// @tparam T Component type
+    template<typename T>
+    concept archetype_component = component<T> && !sparse_component<T>;
+
+    /// @brief Type for family used to generate group IDs
+    using group_id = type_id<struct _group_family_t, std::uint32_t>;
+
+    class basic_group;
+
+    /// @brief Type erased interface of a sparse pool
+    class sparse_pool_base {
+
+        public:
+
+            virtual ~sparse_pool_base() = default;
+
+            virtual void remove(entity_id_t id) = 0;
+            [[nodiscard]] virtual bool contains(entity_id_t id) const noexcept = 0;
+            [[nodiscard]] virtual std::size_t size() const noexcept = 0;
+            [[nodiscard]] virtual std::size_t index_of(entity_id_t id) const noexcept = 0;
+            [[nodiscard]] virtual entity_id_t id_at(std::size_t index) const noexcept = 0;
+            virtual void swap_entries(std::size_t lhs, std::size_t rhs) noexcept = 0;
+
+            /// @brief Group owning this pool, nullptr if not owned
+            [[nodiscard]] basic_group* owner() const noexcept { return owner_; }
+
+        protected:
+
+            friend class basic_group;
+
+            basic_group* owner_{};
+    };
+
+    /// @brief Owning group bookkeeping. Entities having all owned components are kept packed at the
+    /// front of every owned pool, in the same order:
+    /// pool A: |e3|e1|e7|...group size...|e2|e9|
+    /// pool B: |e3|e1|e7|...group size...|e5|
+    /// so iterating the group is a linear walk over aligned arrays.
+    class basic_group {
+
+        public:
+
+            /// @brief Take ownership of the given pools and pack the entities they share
+            /// @param pools owned pools
+            explicit basic_group(std::vector<sparse_pool_base*> pools) : pools_(std::move(pools)) {
+                for (auto* pool : pools_) {
+                    if (pool->owner_ != nullptr) {
+                        throw std::logic_error{"Component pool is already owned by another group"};
+                    }
+                }
+                for (auto* pool : pools_) {
+                    pool->owner_ = this;
+                }
+                for (std::size_t i = 0; i < pools_.front()->size(); ++i) {
+                    on_emplace(pools_.front()->id_at(i));
+                }
+            }
+
+            basic_group(const basic_group&) = delete;
+            basic_group& operator=(const basic_group&) = delete;
+
+            /// @brief Called by an owned pool after id has been added to it
+            void on_emplace(entity_id_t id) noexcept {
+                for (auto* pool : pools_) {
+                    if (!pool->contains(id)) {
+                        return;
+                    }
+                }
+                if (pools_.front()->index_of(id) < size_) {
+                    return;
+                }
+                for (auto* pool : pools_) {
+                    pool->swap_entries(pool->index_of(id), size_);
+                }
+                size_++;
+            }
+
+            /// @brief Called by an owned pool before id is removed from it
+            void on_remove(entity_id_t id) noexcept {
+                for (auto* pool : pools_) {
+                    if (!pool->contains(id)) {
+                        return;
+                    }
+                }
+                if (pools_.front()->index_of(id) >= size_) {
+                    return;
+                }
+                size_--;
+                for (auto* pool : pools_) {
+                    pool->swap_entries(pool->index_of(id), size_);
+                }
+            }
+
+            /// @brief Number of entities in the group
+            [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+        private:
+            std::vector<sparse_pool_base*> pools_;
+            std::size_t size_{};
+    };
+
+    /// @brief Sparse pool of components of type T, keyed by entity id
+    ///
+    /// @tparam T Component type
+    template<component T>
+    class sparse_pool final : public sparse_pool_base {
+
+        public:
+
+            template<typename... Args>
+            T& emplace(entity_id_t id, Args&&... args) {
+                auto [iter, inserted] = data_.emplace(id, std::forward<Args>(args)...);
+                if (!inserted) {
+                    throw std::logic_error{"Entity already has this component"};
+                }
+                if (owner_ != nullptr) {
+                    owner_->on_emplace(id);
+                    return get(id);
+                }
+                return iter->second;
+            }
+
+            void remove(entity_id_t id) override {
+                if (!data_.contains(id)) {
+                    return;
+                }
+                if (owner_ != nullptr) {
+                    owner_->on_remove(id);
+                }
+                data_.erase(id);
+            }
+
+            [[nodiscard]] T& get(entity_id_t id) { return data_.at(id); }
+            [[nodiscard]] const T& get(entity_id_t id) const { return data_.at(id); }
+
+            /// @brief Component at a dense position
+            [[nodiscard]] T& at_index(std::size_t index) noexcept { return data_.values()[index]; }
+            [[nodiscard]] const T& at_index(std::size_t index) const noexcept { return data_.values()[index]; }
+
+            [[nodiscard]] bool contains(entity_id_t id) const noexcept override { return data_.contains(id); }
+            [[nodiscard]] std::size_t size() const noexcept override { return data_.size(); }
+            [[nodiscard]] std::size_t index_of(entity_id_t id) const noexcept override { return data_.index_of(id); }
+            [[nodiscard]] entity_id_t id_at(std::size_t index) const noexcept override { return data_.keys()[index]; }
+
+            void swap_entries(std::size_t lhs, std::size_t rhs) noexcept override {
+                data_.swap_entries(lhs, rhs);
+            }
+
+        private:
+            sparse_map<entity_id_t, T> data_{};
+    };
+
+    /// @brief Typed access to an owning group
+    ///
+    /// @tparam Owned Owned sparse component types
+    template<sparse_component... Owned>
+    class group {
+
+        public:
+
+            group(const basic_group& handler, sparse_pool<Owned>&... pools) noexcept
+                : handler_(&handler), pools_(&pools...) {}
+
+            /// @brief Number of entities in the group
+            [[nodiscard]] std::size_t size() const noexcept {
+                return handler_->size();
+            }
+
+            /// @brief Range of component reference tuples, one per entity in the group
+            decltype(auto) each() const {
+                auto fetch = [pools = pools_](std::size_t index) {
+                    return std::apply([index](auto*... pool) { return std::tuple<Owned&...>(pool->at_index(index)...); }, pools);
+                };
+                return std::views::iota(std::size_t{}, size()) | std::views::transform(fetch);
+            }
+
+            /// @brief Invoke func with references to the owned components of every entity in the group
+            void each(auto&& func) const {
+                const auto n = size();
+                for (std::size_t i = 0; i < n; ++i) {
+                    std::apply([&func, i](auto*... pool) { func(pool->at_index(i)...); }, pools_);
+                }
+            }
+
+        private:
+            const basic_group* handler_;
+            std::tuple<sparse_pool<Owned>*...> pools_;
+    };
+
+}
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <limits>
 #include <memory>
+#include <span>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace ecs {
@@ -24,17 +30,31 @@ constexpr decltype(auto) approx_85_percent(auto value) noexcept {
     return (value * 870) >> 10U; // NOLINT(readability-magic-numbers)
 }
 
-/// @brief Approximately calculate 40% of passed value. 40% is used as a reserve threshold.
+/// @brief Hint the CPU to start loading the cache line holding ptr
+///
+/// @param ptr Address that is about to be read
+inline void prefetch([[maybe_unused]] const void* ptr) noexcept {
+#if defined __GNUC__ || defined __clang__
+    __builtin_prefetch(ptr);
+#endif
+}
+
+/// @brief Calculate 25% of passed value. 25% is used as the shrink threshold, well below the 85% growth threshold
+/// so that a table hovering around one of them does not keep resizing back and forth.
 ///
 /// @param value Value
 /// @return decltype(auto) Result
-constexpr decltype(auto) approx_40_percent(auto value) noexcept {
-    return (value * 409) >> 10U; // NOLINT(readability-magic-numbers)
+constexpr decltype(auto) approx_25_percent(auto value) noexcept {
+    return value >> 2U;
 }
 
 /// @brief Hash Table implementation. This implementation uses open addressing hash table implementation using robin
 /// hood hashing algorithm.
 ///
+/// Resizing is incremental by default: when the table grows or shrinks the current buckets become the old table and
+/// every following insert or erase migrates at most rehash_budget of its buckets into the new one. Lookups and
+/// iteration cover both tables until the old one is drained, so no single operation pays for a full rehash.
+///
 /// @tparam K Key type
 /// @tparam T Mapped type
 /// @tparam is_map Wether this is a map or a set
@@ -54,6 +74,8 @@ public:
     using size_type = std::size_t;
 
     constexpr static size_type default_bucket_count = 16; // the number of buckets the hash table is initialized with
+    constexpr static size_type rehash_budget = 16; // old buckets migrated per insert or erase while resizing
+    constexpr static size_type find_batch = 16; // keys hashed and prefetched ahead of probing in find_many
 
 private:
     /// @brief Bucket info
@@ -70,6 +92,9 @@ private:
     /// @brief Buckets storage
     class buckets {
     public:
+        /// @brief Construct empty buckets
+        constexpr buckets() = default;
+
         /// @brief Construct from allocator and size
         ///
         /// @param alloc: Allocator object
@@ -199,11 +224,20 @@ private:
         /// @param ptr Pointer in the bucket
         /// @param end End pointer in the bucket
         /// @param info Info in the bucket
-        constexpr explicit iterator_impl(pointer ptr, pointer end, info_iter info) noexcept :
-            _ptr(ptr), _end(end), _info(info) {
+        /// @param next Begin of the buckets to continue with once end is reached
+        /// @param next_end End of the buckets to continue with
+        /// @param next_info Info of the buckets to continue with
+        constexpr explicit iterator_impl(pointer ptr,
+            pointer end,
+            info_iter info,
+            pointer next = {},
+            pointer next_end = {},
+            info_iter next_info = {}) noexcept :
+            _ptr(ptr),
+            _end(end), _info(info), _next(next), _next_end(next_end), _next_info(next_info) {
             // fast forward to the next occupied entry in the buckets array
             // if not occupied already or it is not the end.
-            if (_ptr != _end && !_info->occupied) {
+            if (_ptr == _end || !_info->occupied) {
                 fast_forward();
             }
         }
@@ -254,15 +288,27 @@ private:
 
     private:
         constexpr void fast_forward() noexcept {
-            while (_ptr != _end && !_info->occupied) {
-                _info++;
-                _ptr++;
+            while (true) {
+                while (_ptr != _end && !_info->occupied) {
+                    _info++;
+                    _ptr++;
+                }
+                if (_ptr != _end || _next == _next_end) {
+                    return;
+                }
+                // continue with the old table of an ongoing rehash
+                _ptr = std::exchange(_next, nullptr);
+                _end = std::exchange(_next_end, nullptr);
+                _info = std::exchange(_next_info, info_iter{});
             }
         }
 
         pointer _ptr{};
         pointer _end{};
         info_iter _info{};
+        pointer _next{};
+        pointer _next_end{};
+        info_iter _next_info{};
     };
 
 public:
@@ -335,7 +381,7 @@ public:
         const key_equal& equal = key_equal(),
         const Allocator& alloc = Allocator()) :
         _buckets(alloc, bucket_count),
-        _info(default_bucket_count), _equal(equal), _hash(hash) {
+        _info(bucket_count), _equal(equal), _hash(hash) {
         assert((bucket_count % 2 == 0) && "Bucket count must be a power of two");
         for (; first != last; ++first) {
             emplace_or_assign_impl(std::move(*first));
@@ -394,14 +440,14 @@ public:
     ///
     /// @param rhs Right hand side
     constexpr hash_table(const hash_table& rhs) :
-        _info(rhs._info), _size(rhs._size), _hash(rhs._hash), _equal(rhs._equal),
-        _buckets(rhs._buckets.allocator(), rhs._buckets.size()) {
-        for (std::size_t idx{}; const auto& info : _info) {
-            if (info.occupied) {
-                std::uninitialized_copy_n(rhs._buckets.begin() + idx, 1, _buckets.begin() + idx);
-            }
-            idx++;
+        _size(rhs._size), _buckets(rhs._buckets.allocator(), rhs._buckets.size()), _info(rhs._info),
+        _equal(rhs._equal), _hash(rhs._hash), _old_info(rhs._old_info),
+        _rehash_pos(rhs._rehash_pos), _incremental(rhs._incremental) {
+        if (rhs.rehashing()) {
+            _old_buckets = buckets(rhs._old_buckets.allocator(), rhs._old_buckets.size());
         }
+        copy_occupied(rhs._buckets, _info, _buckets);
+        copy_occupied(rhs._old_buckets, _old_info, _old_buckets);
     }
 
     /// @brief Copy assignment operator
@@ -437,6 +483,10 @@ public:
         std::swap(_size, rhs._size);
         std::swap(_equal, rhs._equal);
         std::swap(_hash, rhs._hash);
+        std::swap(_old_buckets, rhs._old_buckets);
+        std::swap(_old_info, rhs._old_info);
+        std::swap(_rehash_pos, rhs._rehash_pos);
+        std::swap(_incremental, rhs._incremental);
     }
 
     /// @brief Get the allocator object
@@ -500,6 +550,7 @@ public:
         for (auto& info : _info) {
             info = bucket_info{};
         }
+        release_old_table();
         _size = 0;
     }
 
@@ -551,6 +602,21 @@ public:
         return emplace_impl(std::forward<Args>(args)...);
     }
 
+    /// @brief Same as emplace, with the hash of the key computed by the caller, e.g. after a find_with_hash miss
+    ///
+    /// @tparam Args Parameter pack
+    /// @param hash Hash of the key, as returned by hash_function()
+    /// @param args args to construct value from
+    /// @return std::pair<iterator, bool> Iterator to the inserted or already-existing element and whether the
+    /// insertion took place
+    template<typename... Args>
+    std::pair<iterator, bool> emplace_with_hash(size_type hash, Args&&... args) {
+        prepare_insert();
+        value_type temp(std::forward<Args>(args)...);
+        assert(hash == _hash(get_key(temp)) && "Hash does not match the key");
+        return emplace_value<false>(std::move(temp), hash);
+    }
+
     /// @brief Erase key from the container
     ///
     /// @param key Key
@@ -615,53 +681,115 @@ public:
         return find_impl(*this, key);
     }
 
-    /// @brief Reserve space in the bucket array
+    /// @brief Find key using a hash computed by the caller
     ///
-    /// @param new_size New size
+    /// @param key Key to find
+    /// @param hash Hash of the key, as returned by hash_function()
+    /// @return iterator Iterator result
+    [[nodiscard]] iterator find_with_hash(const auto& key, size_type hash) noexcept {
+        return find_impl(*this, key, hash);
+    }
+
+    /// @brief Find key using a hash computed by the caller
+    ///
+    /// @param key Key to find
+    /// @param hash Hash of the key, as returned by hash_function()
+    /// @return const_iterator Iterator result
+    [[nodiscard]] const_iterator find_with_hash(const key_type& key, size_type hash) const noexcept {
+        return find_impl(*this, key, hash);
+    }
+
+    /// @brief Find a batch of keys. Keys are hashed and their buckets prefetched find_batch at a time before
+    /// probing, so the cache misses of the lookups overlap instead of being paid one after another.
+    ///
+    /// @param keys Keys to find
+    /// @param out Receives the iterator for each key, end() for missing keys; at least keys.size() long
+    void find_many(std::span<const key_type> keys, std::span<iterator> out) noexcept {
+        find_many_impl(*this, keys, out);
+    }
+
+    /// @brief Find a batch of keys, see the non const overload
+    ///
+    /// @param keys Keys to find
+    /// @param out Receives the iterator for each key, end() for missing keys; at least keys.size() long
+    void find_many(std::span<const key_type> keys, std::span<const_iterator> out) const noexcept {
+        find_many_impl(*this, keys, out);
+    }
+
+    /// @brief Get the hash function object
+    ///
+    /// @return hasher Hash function object
+    [[nodiscard]] hasher hash_function() const {
+        return _hash;
+    }
+
+    /// @brief Reserve space in the bucket array. Unlike the automatic resizes the rehash is done at once.
+    ///
+    /// @param new_size New bucket count, rounded up to a power of two
     void reserve(size_type new_size) {
-        if (new_size < _size) {
+        finish_rehash();
+        if (new_size < _size || new_size <= _buckets.size()) {
             return;
         }
+        begin_rehash(std::bit_ceil(std::max<size_type>(new_size, 2)));
+        finish_rehash();
+    }
 
-        hash_table h_table(new_size, _hash, _equal, _buckets.allocator());
-
-        for (auto& value : *this) {
-            h_table._emplace_impl(std::move(value));
+    /// @brief Enable or disable incremental resizing. When disabled every resize migrates all buckets at once.
+    ///
+    /// @param enabled Whether resizes are spread over the following operations
+    void incremental_rehash(bool enabled) {
+        _incremental = enabled;
+        if (!_incremental) {
+            finish_rehash();
         }
+    }
+
+    /// @brief Check if a resize is in progress, i.e. some elements still live in the old bucket array
+    ///
+    /// @return true If an old bucket array is being migrated
+    /// @return false Otherwise
+    [[nodiscard]] constexpr bool rehashing() const noexcept {
+        return !_old_info.empty();
+    }
 
-        std::swap(_buckets, h_table._buckets);
-        std::swap(_info, h_table._info);
-        std::swap(_size, h_table._size);
-        std::swap(_equal, h_table._equal);
-        std::swap(_hash, h_table._hash);
+    /// @brief Migrate all remaining buckets of an ongoing resize
+    void finish_rehash() {
+        rehash_step(std::numeric_limits<size_type>::max());
     }
 
     /// @brief Get iterator to the begin of the container
     ///
     /// @return Iterator
     [[nodiscard]] constexpr iterator begin() noexcept {
-        return iterator{ _buckets.begin(), _buckets.end(), _info.begin() };
+        return create_iterator(_buckets.begin(), _info.begin());
     }
 
     /// @brief Get iterator to the end of the container
     ///
     /// @return Iterator
     [[nodiscard]] constexpr iterator end() noexcept {
-        return iterator{ _buckets.end(), _buckets.end(), _info.end() };
+        if (rehashing()) {
+            return iterator{ _old_buckets.end(), _old_buckets.end(), _old_info.end() };
+        }
+        return create_iterator(_buckets.end(), _info.end());
     }
 
     /// @brief Get iterator to the begin of the container
     ///
     /// @return Iterator
     [[nodiscard]] constexpr const_iterator begin() const noexcept {
-        return const_iterator{ _buckets.begin(), _buckets.end(), _info.begin() };
+        return create_iterator(_buckets.begin(), _info.begin());
     }
 
     /// @brief Get iterator to the end of the container
     ///
     /// @return Iterator
     [[nodiscard]] constexpr const_iterator end() const noexcept {
-        return const_iterator{ _buckets.end(), _buckets.end(), _info.end() };
+        if (rehashing()) {
+            return const_iterator{ _old_buckets.end(), _old_buckets.end(), _old_info.end() };
+        }
+        return create_iterator(_buckets.end(), _info.end());
     }
 
     /// @brief Get iterator to the begin of the container
@@ -694,129 +822,83 @@ public:
     }
 
 private:
+    constexpr static size_type npos = std::numeric_limits<size_type>::max();
+
     template<typename C>
     void erase_impl(C&& key) {
-        size_type bucket_size = _buckets.size();
-
-        size_type hash = _hash(key);
-        size_type psl = 0;
-        size_type index = mod_2n(hash, bucket_size);
-
-        value_type* ptr{};
-        auto info = _info.begin();
-        while (true) {
-            ptr = _buckets.begin() + index;
-            info = _info.begin() + index;
-
-            if (!info->occupied || psl > info->psl) {
-                return;
-            }
+        const size_type hash = _hash(key);
 
-            if (info->hash != hash || !_equal(get_key(*ptr), key)) {
-                index = mod_2n(index + 1, bucket_size);
-                psl++;
-                continue;
-            }
-
-            break;
+        if (auto index = probe(_buckets, _info, _equal, hash, key); index != npos) {
+            erase_at(_buckets, _info, index);
+        } else if (index = probe(_old_buckets, _old_info, _equal, hash, key); index != npos) {
+            erase_at(_old_buckets, _old_info, index);
+        } else {
+            return;
         }
-
-        value_type temp = std::move(*ptr);
         _size--;
 
-        while (true) {
-            info->occupied = false;
-
-            index = mod_2n(index + 1, bucket_size);
-            auto nptr = _buckets.begin() + index;
-            auto n_info = _info.begin() + index;
-
-            if (!n_info->occupied || n_info->psl == 0) {
-                break;
-            }
-
-            n_info->psl--;
-            *ptr = std::move(*nptr);
-            ptr = nptr;
-            *info = std::move(*n_info);
-            info = n_info;
-        }
-
-        const size_type threshold = approx_40_percent(bucket_size);
-        if (_size > default_bucket_count && _size < threshold) {
-            const auto new_size = bucket_size >> size_type{ 1 };
-            reserve(new_size);
+        const size_type bucket_size = _buckets.size();
+        if (!rehashing() && _size > default_bucket_count && _size < approx_25_percent(bucket_size)) {
+            begin_rehash(bucket_size >> size_type{ 1 });
         }
+        rehash_step(rehash_budget);
     }
 
     template<typename... Args>
     constexpr std::pair<iterator, bool> emplace_impl(Args&&... args) {
-        size_type buckets_size = _buckets.size();
-        const size_type threshold = approx_85_percent(buckets_size);
-        if (_size > threshold) {
-            const auto new_size = buckets_size << size_type{ 1 };
-            reserve(new_size);
-        }
-
+        prepare_insert();
         return _emplace_impl(std::forward<Args>(args)...);
     }
 
     template<typename... Args>
     constexpr std::pair<iterator, bool> emplace_or_assign_impl(Args&&... args) {
-        size_type buckets_size = _buckets.size();
-        const size_type threshold = approx_85_percent(buckets_size);
-        if (_size > threshold) {
-            const auto new_size = buckets_size << size_type{ 1 };
-            reserve(new_size);
-        }
+        prepare_insert();
         return _emplace_or_assign_impl(std::forward<Args>(args)...);
     }
 
     template<typename... Args>
     constexpr std::pair<iterator, bool> _emplace_or_assign_impl(Args&&... args) {
-        size_type buckets_size = _buckets.size();
         value_type temp(std::forward<Args>(args)...);
-        size_type hash = _hash(get_key(temp));
-        size_type psl = 0;
-        bucket_info n_info = { true, hash, psl };
-        size_type index = mod_2n(hash, buckets_size);
+        const size_type hash = _hash(get_key(temp));
+        return emplace_value<true>(std::move(temp), hash);
+    }
 
-        value_type* ret{ nullptr };
-        info_iterator ret_info{};
+    template<typename... Args>
+    constexpr decltype(auto) _emplace_impl(Args&&... args) {
+        value_type temp(std::forward<Args>(args)...);
+        const size_type hash = _hash(get_key(temp));
+        return emplace_value<false>(std::move(temp), hash);
+    }
 
-        while (true) {
-            value_type* ptr = _buckets.begin() + index;
-            auto info = _info.begin() + index;
-            if (info->occupied) {
-                if (info->hash == hash && _equal(get_key(*ptr), get_key(temp))) {
-                    get_value(*ptr) = std::move(get_value(temp));
-                    return std::make_pair(create_iterator(ptr, info), false);
-                }
+    /// @brief Grow the table if the insertion would pass the load threshold and advance an ongoing resize
+    void prepare_insert() {
+        const size_type buckets_size = _buckets.size();
+        if (_size > approx_85_percent(buckets_size)) {
+            begin_rehash(buckets_size << size_type{ 1 });
+        }
+        rehash_step(rehash_budget);
+    }
 
-                if (n_info.psl > info->psl) {
-                    std::swap(temp, *ptr);
-                    std::swap(n_info, *info);
-                }
-                n_info.psl++;
-                index = mod_2n(index + 1, buckets_size);
-                continue;
-            }
-            allocator_traits::construct(_buckets.allocator(), ptr, std::move(temp));
-            *info = n_info;
-            if (!ret) {
-                ret = ptr;
-                ret_info = info;
+    template<bool assign>
+    constexpr std::pair<iterator, bool> emplace_value(value_type&& temp, size_type hash) {
+        if (auto index = probe(_old_buckets, _old_info, _equal, hash, get_key(temp)); index != npos) {
+            value_type* ptr = _old_buckets.begin() + index;
+            if constexpr (assign) {
+                get_value(*ptr) = std::move(get_value(temp));
             }
+            return std::make_pair(iterator{ ptr, _old_buckets.end(), _old_info.begin() + index }, false);
+        }
+        auto result = place<assign>(std::move(temp), hash);
+        if (result.second) {
             _size++;
-            return std::make_pair(create_iterator(ret, ret_info), true);
         }
+        return result;
     }
 
-    template<typename... Args>
-    constexpr decltype(auto) _emplace_impl(Args&&... args) {
+    /// @brief Robin hood insertion of temp into the current bucket array, does not update the size
+    template<bool assign>
+    constexpr std::pair<iterator, bool> place(value_type&& temp, size_type hash) {
         size_type buckets_size = _buckets.size();
-        value_type temp(std::forward<Args>(args)...);
-        size_type hash = _hash(get_key(temp));
         size_type psl = 0;
         bucket_info n_info = { true, hash, psl };
         size_type index = mod_2n(hash, buckets_size);
@@ -829,12 +911,20 @@ private:
             auto info = _info.begin() + index;
             if (info->occupied) {
                 if (info->hash == hash && _equal(get_key(*ptr), get_key(temp))) {
+                    if constexpr (assign) {
+                        get_value(*ptr) = std::move(get_value(temp));
+                    }
                     return std::make_pair(create_iterator(ptr, info), false);
                 }
 
                 if (n_info.psl > info->psl) {
                     std::swap(temp, *ptr);
                     std::swap(n_info, *info);
+                    // the inserted value stays here, temp now holds the displaced one
+                    if (!ret) {
+                        ret = ptr;
+                        ret_info = info;
+                    }
                 }
                 n_info.psl++;
                 index = mod_2n(index + 1, buckets_size);
@@ -846,40 +936,158 @@ private:
                 ret = ptr;
                 ret_info = info;
             }
-            _size++;
             return std::make_pair(create_iterator(ret, ret_info), true);
         }
     }
 
-    static constexpr decltype(auto) find_impl(auto& self, const key_type& key) {
-        size_type buckets_size = self._buckets.size();
+    /// @brief Make the current buckets the old table and start migrating them into new_size buckets
+    void begin_rehash(size_type new_size) {
+        finish_rehash();
+        _old_buckets = std::exchange(_buckets, buckets(_buckets.allocator(), new_size));
+        _old_info = std::exchange(_info, info_storage(new_size));
+        _rehash_pos = 0;
+        if (!_incremental) {
+            finish_rehash();
+        }
+    }
+
+    /// @brief Migrate up to budget buckets of the old table. Entries are taken out at the cursor with backward
+    /// shift deletion, so every slot before the cursor is empty and lookups in the old table stay valid.
+    void rehash_step(size_type budget) {
+        if (!rehashing()) {
+            return;
+        }
+        while (budget-- > 0 && _rehash_pos < _old_info.size()) {
+            if (!_old_info[_rehash_pos].occupied) {
+                _rehash_pos++;
+                continue;
+            }
+            value_type temp(std::move(_old_buckets.begin()[_rehash_pos]));
+            const size_type hash = _old_info[_rehash_pos].hash;
+            erase_at(_old_buckets, _old_info, _rehash_pos);
+            place<false>(std::move(temp), hash);
+        }
+        if (_rehash_pos == _old_info.size()) {
+            release_old_table();
+        }
+    }
+
+    void release_old_table() noexcept {
+        _old_buckets = buckets{};
+        _old_info = info_storage{};
+        _rehash_pos = 0;
+    }
+
+    /// @brief Remove the entry at index, shifting the following entries of the cluster back by one
+    static void erase_at(buckets& table, info_storage& infos, size_type index) {
+        const size_type bucket_size = table.size();
+        value_type* ptr = table.begin() + index;
+        auto info = infos.begin() + index;
+
+        while (true) {
+            index = mod_2n(index + 1, bucket_size);
+            auto nptr = table.begin() + index;
+            auto n_info = infos.begin() + index;
+
+            if (!n_info->occupied || n_info->psl == 0) {
+                break;
+            }
+
+            *ptr = std::move(*nptr);
+            *info = *n_info;
+            info->psl--;
+            ptr = nptr;
+            info = n_info;
+        }
+
+        allocator_traits::destroy(table.allocator(), ptr);
+        *info = bucket_info{};
+    }
+
+    /// @brief Find the index of key in a bucket array
+    ///
+    /// @return size_type Index of the entry or npos
+    static constexpr size_type probe(const buckets& table,
+        const info_storage& infos,
+        const key_equal& equal,
+        size_type hash,
+        const auto& key) {
+        const size_type buckets_size = table.size();
         if (!buckets_size) {
-            return self.end();
+            return npos;
         }
-        size_type hash = self._hash(key);
         size_type index = mod_2n(hash, buckets_size);
 
-        size_type probes = 0;
-        while (true) {
-            auto ptr = self._buckets.begin() + index;
-            auto info = self._info.begin() + index;
-            if (info->occupied && info->hash == hash && self._equal(get_key(*ptr), key)) {
-                return self.create_iterator(ptr, info);
+        for (size_type probes = 0;; probes++) {
+            const auto& info = infos[index];
+            if (info.occupied && info.hash == hash && equal(get_key(table.begin()[index]), key)) {
+                return index;
             }
-            if (!info->occupied || probes > info->psl) {
-                return self.end();
+            if (!info.occupied || probes > info.psl) {
+                return npos;
             }
-            probes++;
             index = mod_2n(index + 1, buckets_size);
         }
     }
 
+    static constexpr decltype(auto) find_impl(auto& self, const auto& key) {
+        return find_impl(self, key, self._hash(key));
+    }
+
+    static constexpr decltype(auto) find_impl(auto& self, const auto& key, size_type hash) {
+        if (auto index = probe(self._buckets, self._info, self._equal, hash, key); index != npos) {
+            return self.create_iterator(self._buckets.begin() + index, self._info.begin() + index);
+        }
+        if (auto index = probe(self._old_buckets, self._old_info, self._equal, hash, key); index != npos) {
+            using iterator_type = decltype(self.end());
+            return iterator_type{ self._old_buckets.begin() + index,
+                self._old_buckets.end(),
+                self._old_info.begin() + index };
+        }
+        return self.end();
+    }
+
+    static constexpr void find_many_impl(auto& self, std::span<const key_type> keys, auto out) {
+        assert(out.size() >= keys.size() && "Output span is too small");
+        std::array<size_type, find_batch> hashes{};
+        const size_type buckets_size = self._buckets.size();
+        for (size_type first = 0; first < keys.size(); first += find_batch) {
+            const size_type count = std::min(find_batch, keys.size() - first);
+            for (size_type i = 0; i < count; i++) {
+                hashes[i] = self._hash(keys[first + i]);
+                if (buckets_size) {
+                    const size_type index = mod_2n(hashes[i], buckets_size);
+                    prefetch(self._info.data() + index);
+                    prefetch(self._buckets.begin() + index);
+                }
+            }
+            for (size_type i = 0; i < count; i++) {
+                out[first + i] = find_impl(self, keys[first + i], hashes[i]);
+            }
+        }
+    }
+
+    /// @brief Iterator to an entry of the current bucket array, continuing into the old one during a resize
     constexpr iterator create_iterator(value_type* ptr, info_iterator info) noexcept {
-        return iterator{ ptr, _buckets.end(), info };
+        return iterator{ ptr, _buckets.end(), info, _old_buckets.begin(), _old_buckets.end(), _old_info.begin() };
     }
 
     constexpr const_iterator create_iterator(const value_type* ptr, info_const_iterator info) const noexcept {
-        return const_iterator{ ptr, _buckets.end(), info };
+        return const_iterator{ ptr,
+            _buckets.end(),
+            info,
+            _old_buckets.begin(),
+            _old_buckets.end(),
+            _old_info.begin() };
+    }
+
+    static void copy_occupied(const buckets& src, const info_storage& infos, buckets& dst) {
+        for (std::size_t idx{}; const auto& info : infos) {
+            if (info.occupied) {
+                std::uninitialized_copy_n(src.begin() + idx, 1, dst.begin() + idx);
+            }
+            idx++;
+        }
     }
 
     constexpr static auto& get_key(auto& entry) {
@@ -903,6 +1111,10 @@ private:
     info_storage _info{ default_bucket_count };
     key_equal _equal{};
     hasher _hash{};
+    buckets _old_buckets{};
+    info_storage _old_info{};
+    size_type _rehash_pos{};
+    bool _incremental{ true };
 };
 
 /// @brief Hash map
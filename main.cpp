@@ -1,7 +1,18 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <cstdio>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "registry.hpp"
+#include "scheduler.hpp"
+#include "replica.hpp"
+#include "concurrent_hash_map.hpp"
 
 struct s1 {
     uint32_t i1;
@@ -17,6 +28,67 @@ struct s3 {
     char c, e;
 };
 
+struct frozen : ecs::flag {};
+
+struct visible {
+    uint32_t layer;
+};
+
+template<>
+struct ecs::enableable<visible> : std::true_type {};
+
+struct velocity {
+    float dx, dy;
+};
+
+struct target {
+    uint32_t id;
+};
+
+struct idle {
+    uint32_t frames;
+};
+
+struct path {
+    std::vector<uint32_t> nodes;
+};
+
+struct chaser {
+    ecs::entity target;
+    uint32_t speed;
+};
+
+struct vec3 {
+    float x, y, z;
+};
+
+template<>
+struct ecs::lane_layout<vec3> {
+    using scalar_type = float;
+    static constexpr std::size_t lanes = 8;
+};
+
+struct transform {
+    vec3 pos;
+    float rot;
+    uint8_t scale;
+};
+
+template<>
+struct ecs::split_members<transform> {
+    static constexpr auto members = std::tuple{ &transform::pos, &transform::rot, &transform::scale };
+};
+
+struct terrain {
+    float heights[64][80];
+};
+
+template<>
+struct ecs::sparse_storage<velocity> : std::true_type {};
+
+template<>
+struct ecs::sparse_storage<target> : std::true_type {};
+
 bool test_create(ecs::registry& reg) {
     std::cout << "Testing creating entities..." << std::endl;
     auto a = reg.create<s1, s3>({1, 2}, {92, 93});
@@ -81,10 +153,999 @@ bool test_size(ecs::registry& reg) {
     return (view.size() == 3);
 };
 
+bool test_checkpoint(ecs::registry&) {
+    std::cout << "Testing file backed storage..." << std::endl;
+    const char* path = "ecs_checkpoint_test.bin";
+    std::remove(path);
+
+    ecs::component_catalog catalog;
+    catalog.add<s1>("s1").add<s3>("s3").add<visible>("visible").add<frozen>("frozen");
+
+    std::vector<ecs::entity> entities;
+    std::size_t last_of_first = 0;
+    bool passed = false;
+    {
+        ecs::mapped_file_storage storage(path, 16, ecs::mem_block::mem_block_size);
+        ecs::registry reg(storage, catalog);
+        for (uint32_t i = 0; i < 2000; ++i) {
+            entities.push_back(reg.create<s1, s3>({i, i * 2ULL}, {'x', 'y'}));
+        }
+        for (uint32_t i = 0; i < 100; ++i) {
+            entities.push_back(reg.create<s1, visible, frozen>({i, 0}, {i}, {i % 2 == 0}));
+        }
+        for (uint32_t i = 2000; i < 2100; i += 3) {
+            reg.disable<visible>(entities[i]);
+        }
+        // the last row of the first chunk is not back-filled, which leaves that chunk partly filled
+        last_of_first = (*reg.view<const s1&, const s3&>().chunks().begin()).max_size() - 1;
+        reg.destroy(entities[last_of_first]);
+        for (uint32_t i = 0; i < 2000; i += 10) {
+            reg.destroy(entities[i]);
+        }
+        reg.destroy_deferred(entities[2005]);
+        reg.checkpoint();
+        passed = !storage.recovered() && storage.checkpoint() == 1 && reg.get<s3>(entities[1]).c == 'x';
+        // written after the checkpoint, saved by the checkpoint on destruction
+        reg.get<s1>(entities[1]).i2 = 42;
+    }
+    {
+        ecs::mapped_file_storage storage(path, 16, ecs::mem_block::mem_block_size);
+        bool threw = false;
+        try {
+            ecs::registry reg(storage);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        passed = passed && threw && storage.recovered() && storage.checkpoint() == 2;
+    }
+    {
+        ecs::mapped_file_storage storage(path, 16, ecs::mem_block::mem_block_size);
+        ecs::registry reg(storage, catalog);
+        bool restored = reg.get<s1>(entities[1]).i2 == 42;
+        std::size_t kept = 0;
+        for (uint32_t i = 0; i < 2000; ++i) {
+            const bool destroyed = i % 10 == 0 || i == last_of_first;
+            restored = restored && reg.alive(entities[i]) != destroyed
+                && (destroyed || (reg.get<s1>(entities[i]).i1 == i && reg.get<s3>(entities[i]).e == 'y'));
+            kept += !destroyed;
+        }
+        for (uint32_t i = 2000; i < 2100; ++i) {
+            if (i == 2005) {
+                restored = restored && !reg.alive(entities[i]);
+                continue;
+            }
+            restored = restored && reg.enabled<visible>(entities[i]) == (i % 3 != 2000 % 3)
+                && reg.get<frozen>(entities[i]).value() == (i % 2 == 0);
+        }
+        auto fresh = reg.create<s1, s3>({7, 7}, {'n', 'n'});
+        passed = passed && restored && storage.checkpoint() == 2 && reg.view<const s1&, const s3&>().size() == kept + 1
+            && reg.view<const s1&, const visible&>().size() == 65 && !reg.alive(entities[0]) && reg.get<s3>(fresh).c == 'n'
+            && reg.get<s1>(entities[2]).i1 == 2;
+    }
+
+    std::remove(path);
+    return passed;
+}
+
+/// @brief Run body on a registry persisted in path in a child process that dies without running
+/// destructors afterwards, like a crash
+template<typename F>
+bool crash_after(const char* path, const ecs::component_catalog& catalog, F&& body) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        ecs::mapped_file_storage storage(path, 16, ecs::mem_block::mem_block_size);
+        ecs::registry reg(storage, catalog);
+        body(reg);
+        _exit(0);
+    }
+    int status = 0;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool test_checkpoint_crash(ecs::registry&) {
+    std::cout << "Testing recovery from a crash after a checkpoint..." << std::endl;
+    const char* path = "ecs_crash_test.bin";
+    const std::string journal = std::string{ path } + ".journal";
+    std::remove(path);
+
+    ecs::component_catalog catalog;
+    catalog.add<s1>("s1").add<s3>("s3");
+    auto intact = [&](uint32_t changed) {
+        ecs::mapped_file_storage storage(path, 16, ecs::mem_block::mem_block_size);
+        ecs::registry reg(storage, catalog);
+        bool same = reg.view<const s1&, const s3&>().size() == 3000 && reg.view<const s1&>().size() == 3000;
+        for (uint32_t i = 0; i < 3000; ++i) {
+            const ecs::entity ent{ i };
+            same = same && reg.alive(ent) && reg.get<s1>(ent).i1 == (i == changed ? 0 : i) && reg.get<s3>(ent).c == 'x';
+        }
+        return same;
+    };
+
+    // changes in place, destroyed rows, new chunks and freed chunks after the checkpoint are lost
+    bool passed = crash_after(path, catalog, [](ecs::registry& reg) {
+        for (uint32_t i = 0; i < 3000; ++i) {
+            reg.create<s1, s3>({i, i}, {'x', 'y'});
+        }
+        reg.checkpoint();
+        reg.each([](s1& ref_s1, s3& ref_s3) { ref_s1.i1 = 7; ref_s3.c = 'z'; });
+        for (uint32_t i = 0; i < 3000; i += 2) {
+            reg.destroy(ecs::entity{ i });
+        }
+        for (uint32_t i = 0; i < 2000; ++i) {
+            reg.create<s1>({0, 0});
+        }
+    });
+    passed = passed && intact(3000);
+
+    // a checkpoint writing a single changed chunk keeps the untouched ones, a torn journal is dropped
+    passed = passed && crash_after(path, catalog, [](ecs::registry& reg) {
+        reg.get<s1>(ecs::entity{ 1500 }).i1 = 0;
+        reg.checkpoint();
+        reg.get<s1>(ecs::entity{ 1 }).i1 = 0;
+        reg.destroy(ecs::entity{ 2 });
+    });
+    if (FILE* torn = std::fopen(journal.c_str(), "wb")) {
+        std::fputs("ECSJOURN", torn);
+        std::fclose(torn);
+    }
+    passed = passed && intact(1500) && access(journal.c_str(), F_OK) != 0;
+
+    std::remove(path);
+    return passed;
+}
+
+bool test_compression(ecs::registry&) {
+    std::cout << "Testing cold chunk compression..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 500; ++i) {
+        entities.push_back(reg.create<s1, s2>({i, 7}, {1.5f, 3}));
+    }
+
+    bool compressed = reg.compress_cold_chunks(1) > 0;
+    bool intact = true;
+    for (uint32_t i = 0; i < entities.size(); ++i) {
+        intact = intact && reg.get<s1>(entities[i]).i1 == i && reg.get<s2>(entities[i]).i1 == 3;
+    }
+
+    // const readers on several threads decompress each chunk once between them
+    bool recompressed = reg.compress_cold_chunks(0) > 0;
+    const auto& readonly = reg;
+    std::vector<uint64_t> sums(4);
+    std::vector<std::thread> readers;
+    for (auto& sum : sums) {
+        readers.emplace_back([&readonly, &sum] {
+            readonly.each([&sum](const s1& ref_s1, const s2& ref_s2) { sum += ref_s1.i1 + ref_s2.i1; });
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    const bool consistent = std::ranges::all_of(sums, [](uint64_t sum) { return sum == 499ULL * 500 / 2 + 3 * 500; });
+    return compressed && intact && recompressed && consistent && reg.view<const s1&>().size() == 500;
+}
+
+bool test_failed_decompression(ecs::registry&) {
+    std::cout << "Testing structural changes on chunks that cannot be decompressed..." << std::endl;
+    ecs::fixed_block_storage arena(4, ecs::mem_block::mem_block_size);
+    ecs::registry reg(arena);
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        entities.push_back(reg.create<s1, s2>({i, 7}, {1.5f, 3}));
+    }
+    reg.destroy_deferred(entities[10]);
+    bool compressed = reg.compress_cold_chunks(0) > 0;
+    // take every block the compressed chunks gave back
+    std::vector<ecs::entity> fillers;
+    while (auto e = reg.try_create<s3>({'f', 'f'})) {
+        fillers.push_back(*e);
+    }
+
+    auto fails = [](auto&& change) {
+        try {
+            change();
+        } catch (const std::bad_alloc&) {
+            return true;
+        }
+        return false;
+    };
+    bool failed = fails([&] { reg.destroy(entities[0]); })
+        && fails([&] { reg.modify<ecs::add<s3>>(entities[1], s3{'a', 'b'}); })
+        && fails([&] { reg.compact(); });
+
+    for (auto e : fillers) {
+        reg.destroy(e);
+    }
+    bool untouched = reg.alive(entities[0]) && !reg.has<s3>(entities[1]) && reg.view<const s1&, const s2&>().size() == 999;
+    for (uint32_t i = 0; i < entities.size(); ++i) {
+        untouched = untouched && (i == 10 || reg.get<s1>(entities[i]).i1 == i);
+    }
+    reg.destroy(entities[0]);
+    reg.modify<ecs::add<s3>>(entities[1], s3{'a', 'b'});
+    reg.compact();
+    return compressed && !fillers.empty() && failed && untouched && reg.view<const s1&, const s2&>().size() == 998
+        && reg.get<s3>(entities[1]).c == 'a' && reg.get<s1>(entities[999]).i1 == 999;
+}
+
+/// @brief Storage handing out recycled memory, filled with a pattern instead of zeros
+class dirty_storage final : public ecs::block_storage {
+    public:
+        explicit dirty_storage(unsigned char pattern) noexcept : pattern_(pattern) {}
+
+        [[nodiscard]] std::byte* allocate(std::size_t size) noexcept override {
+            auto* ptr = ecs::heap_storage::instance().allocate(size);
+            if (ptr != nullptr) {
+                std::memset(ptr, pattern_, size);
+            }
+            return ptr;
+        }
+
+        void deallocate(std::byte* ptr, std::size_t size) noexcept override {
+            ecs::heap_storage::instance().deallocate(ptr, size);
+        }
+
+    private:
+        unsigned char pattern_;
+};
+
+bool test_dirty_decompression(ecs::registry&) {
+    std::cout << "Testing flag columns after decompression..." << std::endl;
+    bool passed = true;
+    for (const unsigned char pattern : { 0x55, 0xFF }) {
+        dirty_storage storage(pattern);
+        ecs::registry reg(storage);
+        std::vector<ecs::entity> entities;
+        for (uint32_t i = 0; i < 300; ++i) {
+            reg.create<s1, frozen>({i, 0}, {false});
+            entities.push_back(reg.create<s1, visible>({i, 0}, {i}));
+        }
+        const bool compressed = reg.compress_cold_chunks(0) >= 2;
+        for (uint32_t i = 0; i < 30; ++i) {
+            reg.create<s1, frozen>({i, 0}, {false});
+            entities.push_back(reg.create<s1, visible>({i, 0}, {i}));
+        }
+        for (std::size_t i = 1; i < entities.size(); ++i) {
+            reg.disable<visible>(entities[i]);
+        }
+
+        std::size_t visited = 0;
+        for ([[maybe_unused]] const auto& [ref_s1, ref_visible] : reg.view<const s1&, const visible&>().each()) {
+            visited++;
+            if (visited > entities.size()) {
+                break;
+            }
+        }
+        passed = passed && compressed && reg.view<const s1&, const frozen&>().count<frozen>() == 0
+            && reg.view<const s1&, const visible&>().size() == 1 && visited == 1;
+    }
+    return passed;
+}
+
+bool test_flags(ecs::registry&) {
+    std::cout << "Testing flag components..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 300; ++i) {
+        entities.push_back(reg.create<s1, frozen>({i, 0}, {i % 3 == 0}));
+    }
+    reg.destroy(entities[0]);
+    reg.get<frozen>(entities[1]) = true;
+
+    std::size_t frozen_count = 0;
+    for (const auto& [ref_s1, ref_frozen] : reg.view<const s1&, const frozen&>().each()) {
+        frozen_count += ref_frozen.value() && ref_s1.i1 % 3 == 0;
+    }
+    return frozen_count == 99 && reg.view<const s1&, const frozen&>().count<frozen>() == 100;
+}
+
+bool test_enable(ecs::registry&) {
+    std::cout << "Testing enableable components..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 200; ++i) {
+        entities.push_back(reg.create<s1, visible>({i, 0}, {i}));
+    }
+    for (uint32_t i = 0; i < 200; i += 2) {
+        reg.disable<visible>(entities[i]);
+    }
+
+    uint32_t visited = 0;
+    for (const auto& [ref_s1, ref_visible] : reg.view<const s1&, const visible&>().each()) {
+        visited += ref_visible.layer % 2;
+    }
+    auto view = reg.view<const s1&, const visible&>();
+    return visited == 100 && view.size() == 100 && !reg.enabled<visible>(entities[0])
+        && reg.view<const s1&>().size() == 200;
+}
+
+template<typename... C>
+concept creatable = requires(ecs::registry& reg, C... c) { reg.create<C...>(std::move(c)...); };
+
+template<typename... C>
+concept declarable = requires(ecs::registry& reg) { reg.declare<C...>(); };
+
+// sparse components live in their pools only, archetype paths reject them at compile time
+static_assert(creatable<s1> && !creatable<s1, velocity> && declarable<s1> && !declarable<target>);
+
+bool test_group(ecs::registry&) {
+    std::cout << "Testing owning groups..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 100; ++i) {
+        auto e = reg.create<s1>({i, 0});
+        reg.emplace<velocity>(e, 1.0f, 2.0f);
+        if (i % 2 == 0) {
+            reg.emplace<target>(e, i);
+        }
+        entities.push_back(e);
+    }
+
+    auto group = reg.group<velocity, target>();
+    bool sized = group.size() == 50;
+
+    reg.remove<target>(entities[0]);
+    reg.destroy(entities[2]);
+    reg.emplace<target>(entities[1], 1U);
+
+    uint32_t odd = 0;
+    group.each([&odd](velocity& v, target& t) { odd += t.id % 2; v.dx += 1.0f; });
+    return sized && group.size() == 49 && odd == 1 && reg.get<velocity>(entities[1]).dx == 2.0f
+        && !reg.has<target>(entities[0]);
+}
+
+bool test_component_ids(ecs::registry&) {
+    std::cout << "Testing registry local component ids..." << std::endl;
+    ecs::registry first;
+    ecs::registry second;
+    auto a = first.create<s3>({'a', 'b'});
+    auto b = second.create<s2, s3>({1.0f, 2}, {'c', 'd'});
+    const auto& index = first.components();
+    return index.size() == 2 && index.find<s3>() == 1 && index.find<s2>() == ecs::component_index::invalid_id
+        && second.components().find<s3>() == 2 && !first.has<s2>(a) && second.has<s2>(b)
+        && first.get<s3>(a).e == 'b' && second.get<s3>(b).c == 'c';
+}
+
+bool test_modify(ecs::registry&) {
+    std::cout << "Testing combined structural changes..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 10; ++i) {
+        entities.push_back(reg.create<s1, idle>({i, 0}, {i}));
+    }
+    reg.modify<ecs::add<s2, path>, ecs::remove<idle>>(entities[3], s2{1.5f, 3}, path{{1, 2, 3}});
+    reg.modify<ecs::add<>, ecs::remove<idle, s3>>(entities[5]);
+
+    bool threw = false;
+    try {
+        reg.modify<ecs::add<s1>>(entities[0], s1{});
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+
+    const auto& moved = reg.get<path>(entities[3]);
+    return threw && moved.nodes.size() == 3 && reg.get<s1>(entities[3]).i1 == 3 && !reg.has<idle>(entities[3])
+        && reg.has<s1>(entities[5]) && !reg.has<idle>(entities[5]) && reg.get<idle>(entities[9]).frames == 9
+        && reg.view<const idle&>().size() == 8 && reg.view<const s1&, const path&>().size() == 1;
+}
+
+bool test_create_in_place(ecs::registry&) {
+    std::cout << "Testing in place creation..." << std::endl;
+    ecs::registry reg;
+    auto a = reg.create<path, s3, frozen>(std::piecewise_construct,
+        std::forward_as_tuple(std::vector<uint32_t>(4, 7U)), std::forward_as_tuple('p', 'q'), std::forward_as_tuple(true));
+    auto [b, first, second] = reg.create_uninitialized<s1, s2>();
+    first->i1 = 11;
+    first->i2 = 12;
+    second->f1 = 0.5f;
+    second->i1 = 13;
+    return reg.get<path>(a).nodes.size() == 4 && reg.get<s3>(a).e == 'q' && reg.get<frozen>(a)
+        && reg.get<s1>(b).i2 == 12 && reg.get<s2>(b).i1 == 13;
+}
+
+bool test_lanes(ecs::registry&) {
+    std::cout << "Testing lane block layout..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 20; ++i) {
+        auto f = static_cast<float>(i);
+        entities.push_back(reg.create<s1, vec3>({i, 0}, {f, 2 * f, 3 * f}));
+    }
+
+    // add the x member of every lane to its y member, one lane block at a time
+    std::size_t blocks = 0;
+    for (auto& chunk : reg.view<vec3&>().chunks()) {
+        for (auto& block : chunk.lane_blocks<vec3>()) {
+            bool aligned = reinterpret_cast<std::uintptr_t>(block.data[0]) % 32 == 0;
+            for (std::size_t l = 0; aligned && l < block.lanes; ++l) {
+                block.data[1][l] += block.data[0][l];
+            }
+            blocks += aligned;
+        }
+    }
+
+    reg.get<vec3>(entities[4]) = vec3{ -1.0f, -2.0f, -3.0f };
+    reg.modify<ecs::add<s3>>(entities[9], s3{ 'l', 'm' });
+
+    float sum = 0.0f;
+    reg.each([&sum](const vec3& v) { sum += v.y; });
+    vec3 moved = reg.get<vec3>(entities[9]);
+    vec3 written = reg.get<vec3>(entities[4]);
+    return blocks == 3 && moved.y == 27.0f && moved.z == 27.0f && written.x == -1.0f && written.z == -3.0f
+        && sum == 3.0f * 190.0f - 12.0f - 2.0f;
+}
+
+bool test_split(ecs::registry&) {
+    std::cout << "Testing member wise split components..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 300; ++i) {
+        auto f = static_cast<float>(i);
+        entities.push_back(reg.create<s1, transform>({i, 0}, {{f, f, f}, f, static_cast<uint8_t>(i % 7)}));
+    }
+
+    // touch only the rot sub-column
+    float rot = 0.0f;
+    bool contiguous = true;
+    for (auto& chunk : reg.view<const transform&>().chunks()) {
+        auto column = chunk.field_column<&transform::rot>();
+        contiguous = contiguous && (column.size() < 2 || &column[1] == &column[0] + 1);
+        for (float r : column) {
+            rot += r;
+        }
+    }
+
+    for (auto [t] : reg.view<transform&>().each()) {
+        t.field<&transform::pos>().y += 1.0f;
+    }
+    reg.get<transform>(entities[10]) = transform{{0.0f, 0.0f, 0.0f}, -5.0f, 42};
+    reg.modify<ecs::remove<s1>>(entities[20]);
+
+    transform ten = reg.get<transform>(entities[10]);
+    transform twenty = reg.get<transform>(entities[20]);
+    return contiguous && rot == 300.0f * 299.0f / 2.0f && ten.rot == -5.0f && ten.scale == 42
+        && twenty.pos.y == 21.0f && twenty.rot == 20.0f && twenty.scale == 6;
+}
+
+bool test_large(ecs::registry&) {
+    std::cout << "Testing oversized components..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 20; ++i) {
+        auto e = reg.create<s1, terrain>({i, 0}, {});
+        reg.get<terrain>(e).heights[63][79] = static_cast<float>(i);
+        entities.push_back(e);
+    }
+    reg.destroy(entities[3]);
+
+    bool large = true;
+    for (auto& chunk : reg.view<const terrain&>().chunks()) {
+        large = large && chunk.block_size() > ecs::mem_block::mem_block_size && chunk.max_size() >= 8;
+    }
+    float sum = 0.0f;
+    for (const auto& [t] : reg.view<const terrain&>().each()) {
+        sum += t.heights[63][79];
+    }
+    return large && sum == 190.0f - 3.0f && reg.get<s1>(entities[19]).i1 == 19;
+}
+
+bool test_fixed_capacity(ecs::registry&) {
+    std::cout << "Testing fixed capacity registry..." << std::endl;
+    ecs::registry reg(ecs::registry_config{ 5000, 2, 4 });
+    std::vector<ecs::entity> entities;
+    while (auto e = reg.try_create<s1, s2>({1, 2}, {3.0f, 4})) {
+        entities.push_back(*e);
+    }
+    const auto chunk_rows = entities.size();
+    bool other = reg.try_create<s3>({'a', 'b'}).has_value();
+    bool third = reg.try_create<s2>({}).has_value();
+
+    reg.destroy(entities.back());
+    bool reused = reg.try_create<s1, s2>({5, 6}, {7.0f, 8}).has_value();
+
+    ecs::registry small(ecs::registry_config{ 3, 1, 1 });
+    std::size_t created = 0;
+    std::optional<ecs::entity> last;
+    while (auto e = small.try_create<s3>({'x', 'y'})) {
+        last = e;
+        created++;
+    }
+    // a deferred destroy keeps its row and ID until compaction
+    small.destroy_deferred(*last);
+    const bool retired_counted = !small.try_create<s3>({'x', 'y'});
+    small.compact();
+    const bool compacted = small.try_create<s3>({'x', 'y'}).has_value();
+    return created == 3 && chunk_rows > 0 && chunk_rows % reg.view<const s1&>().chunks().front().max_size() == 0
+        && !other && !third && reused && retired_counted && compacted;
+}
+
+bool test_rehash(ecs::registry&) {
+    std::cout << "Testing incremental rehash..." << std::endl;
+    ecs::hash_map<int, std::string> map;
+    bool seen_rehash = false;
+    bool consistent = true;
+    for (int i = 0; i < 20000; ++i) {
+        map.emplace(i, std::to_string(i));
+        if (map.rehashing()) {
+            seen_rehash = true;
+            std::size_t count = 0;
+            for ([[maybe_unused]] auto& entry : map) {
+                count++;
+            }
+            consistent = consistent && count == map.size() && map.contains(i / 2) && map.at(i / 3) == std::to_string(i / 3);
+        }
+    }
+    for (int i = 0; i < 19000; ++i) {
+        map.erase(i);
+    }
+    bool found = true;
+    for (int i = 19000; i < 20000; ++i) {
+        found = found && map.at(i) == std::to_string(i);
+    }
+    auto copy = map;
+    map.finish_rehash();
+    return seen_rehash && consistent && found && !map.contains(5) && map.size() == 1000 && copy.size() == 1000
+        && copy.at(19500) == "19500" && !map.rehashing();
+}
+
+bool test_batched_find(ecs::registry&) {
+    std::cout << "Testing batched hash map lookups..." << std::endl;
+    ecs::hash_map<int, int> map;
+    for (int i = 0; i < 100; i += 2) {
+        const auto hash = map.hash_function()(i);
+        map.emplace_with_hash(hash, i, i * 10);
+    }
+    std::vector<int> keys(40);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::vector<ecs::hash_map<int, int>::iterator> found(keys.size());
+    map.find_many(keys, found);
+
+    bool ok = map.size() == 50;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        const bool expected = keys[i] % 2 == 0;
+        ok = ok && (found[i] != map.end()) == expected && (!expected || found[i]->second == keys[i] * 10);
+    }
+    const auto& cmap = map;
+    auto iter = cmap.find_with_hash(42, map.hash_function()(42));
+    return ok && iter != cmap.end() && iter->second == 420 && !map.emplace_with_hash(map.hash_function()(4), 4, 0).second;
+}
+
+bool test_concurrent_map(ecs::registry&) {
+    std::cout << "Testing concurrent hash map..." << std::endl;
+    ecs::concurrent_hash_map<int, long> map(4);
+    std::atomic<bool> consistent = true;
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            while (!done) {
+                for (int key = 0; key < 4000; key += 7) {
+                    if (auto value = map.find(key); value && *value != key * 3L) {
+                        consistent = false;
+                    }
+                }
+            }
+        });
+    }
+    std::thread writer([&] {
+        for (int key = 0; key < 4000; ++key) {
+            map.insert(key, key * 3L);
+        }
+        for (int key = 0; key < 4000; key += 2) {
+            map.erase(key);
+        }
+    });
+    writer.join();
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    map.reclaim();
+    return consistent && map.size() == 2000 && !map.contains(10) && map.find(11) == 33L
+        && !map.insert(11, 0) && !map.insert_or_assign(11, 5) && map.find(11) == 5L;
+}
+
+bool test_sparse_map(ecs::registry&) {
+    std::cout << "Testing sparse map split layout..." << std::endl;
+    ecs::sparse_map<uint32_t, std::string> map{ {9, "nine"}, {2, "two"}, {5, "five"} };
+    std::vector<std::pair<uint32_t, std::string>> more{ {7, "seven"}, {1, "one"}, {2, "dup"} };
+    map.insert(more.begin(), more.end());
+    map.sort();
+
+    bool sorted = std::ranges::is_sorted(map.keys()) && map.size() == 5 && map.values().front() == "one";
+    for (const auto& [key, value] : map) {
+        sorted = sorted && map.at(key) == value;
+    }
+    map.find(5)->second += "!";
+
+    const std::vector<uint32_t> erased{ 2, 7, 42 };
+    const auto count = map.erase(erased);
+    const std::vector<uint32_t> expected{ 1, 5, 9 };
+    return sorted && count == 2 && std::ranges::equal(map.keys(), expected) && map.at(5) == "five!"
+        && !map.contains(7) && map.values().back() == "nine";
+}
+
+bool test_lazy_destroy(ecs::registry&) {
+    std::cout << "Testing deferred destroy and compaction..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 3000; ++i) {
+        entities.push_back(reg.create<s1, frozen>({i, i}, {}));
+    }
+    for (uint32_t i = 0; i < 3000; ++i) {
+        reg.get<frozen>(entities[i]) = true;
+        if (i % 3 != 0) {
+            reg.destroy_deferred(entities[i]);
+        }
+    }
+
+    uint32_t visited = 0;
+    bool skipped = true;
+    for (const auto& [ref_s1] : reg.view<const s1&>().each()) {
+        skipped = skipped && ref_s1.i1 % 3 == 0;
+        visited++;
+    }
+    auto view = reg.view<const s1&, const frozen&>();
+    bool deferred = visited == 1000 && skipped && view.size() == 1000 && view.count<frozen>() == 1000
+        && !reg.alive(entities[1]);
+
+    const auto removed = reg.compact();
+    uint32_t previous = 0;
+    bool ordered = true;
+    for (const auto& [ref_s1] : reg.view<const s1&>().each()) {
+        ordered = ordered && (previous == 0 || ref_s1.i1 > previous) && ref_s1.i1 % 3 == 0;
+        previous = ref_s1.i1;
+    }
+    bool located = true;
+    for (uint32_t i = 0; i < 3000; i += 3) {
+        located = located && std::get<0>(reg.get<const s1&>(entities[i])).i2 == i;
+    }
+    auto reused = reg.create<s1, frozen>({7, 7}, {});
+    return deferred && removed == 2000 && ordered && located && reused.id() < 3000
+        && reg.view<const s1&>().size() == 1001;
+}
+
+bool test_destroy_if(ecs::registry&) {
+    std::cout << "Testing predicate destroy..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 3000; ++i) {
+        entities.push_back(reg.create<s1, path, frozen>({i, i}, {{i, i + 1}}, {}));
+        reg.get<frozen>(entities.back()) = i % 4 == 0;
+    }
+    auto other = reg.create<s2>({1.0f, 2});
+    reg.destroy_deferred(entities[1]);
+
+    const auto destroyed = reg.destroy_if<const s1&, const frozen&>([](const s1& ref_s1, bool is_frozen) {
+        return ref_s1.i1 % 3 == 0 || is_frozen;
+    });
+
+    uint32_t previous = 0;
+    std::size_t visited = 0;
+    bool survivors = true;
+    for (const auto& [ref_s1, ref_path] : reg.view<const s1&, const path&>().each()) {
+        survivors = survivors && ref_s1.i1 % 3 != 0 && ref_s1.i1 % 4 != 0 && ref_s1.i1 > previous
+            && ref_path.nodes.size() == 2 && ref_path.nodes[1] == ref_s1.i1 + 1;
+        previous = ref_s1.i1;
+        visited++;
+    }
+    bool located = true;
+    for (uint32_t i = 2; i < 3000; ++i) {
+        if (i % 3 != 0 && i % 4 != 0) {
+            located = located && std::get<0>(reg.get<const s1&>(entities[i])).i2 == i;
+        }
+    }
+    auto reused = reg.create<s1, path, frozen>({}, {}, {});
+    return destroyed == 1500 && visited == 1499 && survivors && located && !reg.alive(entities[0])
+        && !reg.alive(entities[1]) && reg.alive(other) && reused.id() < 3000;
+}
+
+bool test_declare(ecs::registry&) {
+    std::cout << "Testing archetype declaration..." << std::endl;
+    ecs::registry reg;
+    ecs::component_catalog catalog;
+    catalog.add<s1>("s1").add<s2>("s2").add<visible>("visible").add<path>("path").add<idle>("idle");
+
+    std::istringstream file{
+        "# startup archetypes\n"
+        "s1 visible\n"
+        "\n"
+        "s1 idle > +path +s2 -idle   # start chasing\n"
+        "s2 s1\n"};
+    const auto created = reg.declare(file, catalog);
+    reg.declare<s2>(ecs::add<s3>{});
+    reg.declare<s1, s2>(ecs::add<visible>{}, ecs::remove<s2>{});
+    const auto declared = reg.archetype_count();
+
+    auto e = reg.create<s1, idle>({1, 2}, {3});
+    reg.modify<ecs::add<s2, path>, ecs::remove<idle>>(e, s2{4.0f, 5}, path{{6}});
+    auto other = reg.create<s2>({7.0f, 8});
+    reg.modify<ecs::add<s3>>(other, s3{'a', 'b'});
+    auto third = reg.create<s1, s2>({9, 10}, {11.0f, 12});
+    reg.modify<ecs::add<visible>, ecs::remove<s2>>(third, visible{13});
+
+    bool unknown = false;
+    try {
+        std::istringstream bad{"s1 position\n"};
+        reg.declare(bad, catalog);
+    } catch (const std::invalid_argument&) {
+        unknown = true;
+    }
+    return created == 4 && declared == 6 && reg.archetype_count() == declared
+        && reg.has<path>(e) && !reg.has<idle>(e) && std::get<0>(reg.get<const s2&>(e)).i1 == 5
+        && reg.has<s3>(other) && reg.has<visible>(third) && !reg.has<s2>(third) && unknown;
+}
+
+bool test_chunk_directory(ecs::registry&) {
+    std::cout << "Testing stable chunk directory..." << std::endl;
+    ecs::segmented_vector<std::string, 2> strings;
+    std::vector<const std::string*> addresses;
+    for (int i = 0; i < 100; ++i) {
+        addresses.push_back(&strings.emplace_back(std::to_string(i)));
+    }
+    bool stable = strings.size() == 100 && strings.at(57) == "57" && strings.back() == "99";
+    for (int i = 0; i < 100; ++i) {
+        stable = stable && addresses[i] == &strings[i] && strings[i] == std::to_string(i);
+    }
+    strings.pop_back();
+    const auto joined = std::accumulate(strings.begin() + 95, strings.end(), std::string{});
+
+    ecs::registry reg;
+    auto first = reg.create<s1, s2>({0, 0}, {0.0f, 0});
+    for (uint32_t i = 1; i < 1000; ++i) {
+        reg.create<s1, s2>({i, i}, {0.0f, 0});
+    }
+    const ecs::mem_block* first_chunk = &*reg.view<s1&>().chunks().begin();
+    const auto* first_row = first_chunk->const_ptr<s1>(0);
+    for (uint32_t i = 1000; i < 20000; ++i) {
+        reg.create<s1, s2>({i, i}, {0.0f, 0});
+    }
+    auto chunks = reg.view<s1&>().chunks();
+    return stable && joined == "95969798" && strings.size() == 99 && std::ranges::distance(chunks) > 10
+        && &*chunks.begin() == first_chunk && &std::get<0>(reg.get<const s1&>(first)) == first_row;
+}
+
+bool test_join(ecs::registry&) {
+    std::cout << "Testing entity reference joins..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> targets;
+    for (uint32_t i = 0; i < 500; ++i) {
+        targets.push_back(i % 2 == 0 ? reg.create<s2>({static_cast<float>(i), 0}) : reg.create<s2, s3>({static_cast<float>(i), 0}, {}));
+    }
+    auto no_s2 = reg.create<s3>({});
+    std::vector<ecs::entity> chasers;
+    for (uint32_t i = 0; i < 2000; ++i) {
+        chasers.push_back(reg.create<chaser, s1>({targets[(i * 7) % 500], i}, {0, 0}));
+    }
+    reg.get<chaser>(chasers[0]).target = no_s2;
+    reg.destroy(targets[3]);
+
+    std::size_t joined = 0;
+    bool matched = true;
+    reg.view<const chaser&, s1&>().join<&chaser::target, const s2&>([&](const chaser& c, s1& ref_s1, const s2& target) {
+        matched = matched && target.f1 == static_cast<float>((c.speed * 7) % 500);
+        ref_s1.i2 = static_cast<uint64_t>(target.f1);
+        joined++;
+    });
+
+    std::size_t const_joined = 0;
+    std::as_const(reg).view<const chaser&>().join<&chaser::target, const s2&, const s3&>([&](const chaser&, const s2&, const s3&) {
+        const_joined++;
+    });
+    const auto& moved = std::get<0>(reg.get<const s1&>(chasers[1]));
+    return joined == 2000 - 1 - 4 && matched && moved.i2 == 7 && const_joined == 1000 - 4;
+}
+
+bool test_reactive(ecs::registry&) {
+    std::cout << "Testing reactive systems..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        entities.push_back(reg.create<s1, s2>({i, 0}, {0.0f, 0}));
+    }
+    for (uint32_t i = 0; i < 100; ++i) {
+        reg.create<s3>({});
+    }
+
+    ecs::scheduler scheduler(reg);
+    std::size_t copies = 0;
+    std::size_t visited = 0;
+    std::size_t s3_runs = 0;
+    scheduler.add_reactive<s1>([&](ecs::registry& r, std::uint64_t since) {
+        copies++;
+        r.view<const s1&, s2&>().each_changed<s1>(since, [&](const s1& ref_s1, s2& ref_s2) {
+            ref_s2.i1 = static_cast<int>(ref_s1.i1);
+            visited++;
+        });
+    });
+    scheduler.add_reactive<s3>([&](ecs::registry&, std::uint64_t) { s3_runs++; });
+
+    const auto first = scheduler.run();
+    const auto idle = scheduler.run();
+    bool copied = copies == 1 && visited == 5000 && s3_runs == 1 && first == 0 && idle == 2;
+
+    reg.get<s1>(entities[4321]).i1 = 7;
+    visited = 0;
+    const auto after_write = scheduler.run();
+    const bool one_chunk = copies == 2 && visited > 0 && visited < 5000 && after_write == 1
+        && std::get<0>(reg.get<const s2&>(entities[4321])).i1 == 7;
+
+    // reading and writing other columns does not wake the system up
+    for (auto [ref_s2] : reg.view<s2&>().each()) {
+        ref_s2.f1 = 1.0f;
+    }
+    const auto untouched = scheduler.run();
+
+    reg.destroy(entities.back());
+    const auto after_destroy = scheduler.run();
+
+    // enabling or disabling changes the rows views of a component visit
+    auto shown = reg.create<visible>({1});
+    std::size_t visible_runs = 0;
+    ecs::scheduler visibility(reg);
+    visibility.add_reactive<visible>([&](ecs::registry&, std::uint64_t) { visible_runs++; });
+    visibility.run();
+    const auto visible_idle = visibility.run();
+    reg.disable<visible>(shown);
+    const auto after_disable = visibility.run();
+    reg.disable<visible>(shown);
+    const auto disabled_again = visibility.run();
+    reg.enable<visible>(shown);
+    visibility.run();
+
+    return copied && one_chunk && untouched == 2 && after_destroy == 1 && copies == 3 && s3_runs == 1
+        && !reg.view<const s1&>().changed<s1>(reg.version()) && reg.changed<s1>(0)
+        && visible_idle == 1 && after_disable == 0 && disabled_again == 1 && visible_runs == 3;
+}
+
+bool test_replica(ecs::registry&) {
+    std::cout << "Testing shared memory replicas..." << std::endl;
+    const auto name = "/ecs_replica_test_" + std::to_string(::getpid());
+    ecs::shared_memory_storage storage(name, 64, ecs::mem_block::mem_block_size, 4096);
+    ecs::registry reg(storage);
+    ecs::replica_writer writer(storage);
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 3000; ++i) {
+        entities.push_back(reg.create<s1, s2>({i, i}, {0.0f, 0}));
+    }
+    reg.create<s3>({'r', 'o'});
+    writer.publish(reg);
+
+    ecs::replica_reader reader(name);
+    std::size_t rows = 0;
+    uint64_t sum = 0;
+    const auto first = reader.read([&](const ecs::replica_reader& replica) {
+        rows = 0;
+        sum = 0;
+        replica.each<ecs::entity, s1>([&](const ecs::entity& e, const s1& ref_s1) {
+            rows++;
+            sum += ref_s1.i1 + (e == entities[ref_s1.i1] ? 0 : 1000000);
+        });
+    });
+    bool snapshot = rows == 3000 && sum == 2999ULL * 3000 / 2 && first % 2 == 0;
+
+    std::atomic<bool> done = false;
+    std::thread simulation([&] {
+        for (int frame = 0; frame < 200; ++frame) {
+            writer.begin_update();
+            for (auto [ref_s1] : reg.view<s1&>().each()) {
+                ref_s1.i1++;
+                ref_s1.i2 = ref_s1.i1;
+            }
+            if (frame % 50 == 0) {
+                reg.create<s1, s2>({0, 0}, {0.0f, 0});
+            }
+            writer.publish(reg);
+        }
+        done = true;
+    });
+    bool consistent = true;
+    std::size_t reads = 0;
+    while (!done) {
+        bool torn = false;
+        reader.read([&](const ecs::replica_reader& replica) {
+            torn = false;
+            replica.each<s1>([&](const s1& ref_s1) {
+                torn = torn || ref_s1.i1 != ref_s1.i2;
+            });
+        });
+        consistent = consistent && !torn;
+        reads++;
+    }
+    simulation.join();
+
+    std::size_t s3_rows = 0;
+    reader.read([&](const ecs::replica_reader& replica) {
+        s3_rows = 0;
+        replica.each<s3>([&](const s3& ref_s3) { s3_rows += ref_s3.c == 'r'; });
+    });
+
+    // small chunks carved out of the last block of the object are bounded by their own size
+    const auto tiny_name = name + "_tiny";
+    ecs::shared_memory_storage tiny_storage(tiny_name, 1, ecs::mem_block::mem_block_size, 4096);
+    ecs::registry tiny(tiny_storage);
+    tiny.create<s3>({'a', 'b'});
+    tiny.create<s2>({1.0f, 2});
+    ecs::replica_writer(tiny_storage).publish(tiny);
+    ecs::replica_reader tiny_reader(tiny_name);
+    std::size_t small_rows = 0;
+    tiny_reader.read([&](const ecs::replica_reader& replica) {
+        small_rows = 0;
+        replica.each<s3>([&](const s3&) { small_rows++; });
+        replica.each<s2>([&](const s2& ref_s2) { small_rows += ref_s2.i1; });
+    });
+    return snapshot && consistent && reads > 0 && s3_rows == 1 && reader.sequence() % 2 == 0 && small_rows == 3;
+}
+
+bool test_split_view(ecs::registry&) {
+    std::cout << "Testing split views..." << std::endl;
+    ecs::registry reg;
+    std::vector<ecs::entity> entities;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        entities.push_back(reg.create<s1, visible>({i, 0}, {i}));
+    }
+    for (uint32_t i = 0; i < 300; ++i) {
+        reg.create<s1, s3>({i, 0}, {'s', 'p'});
+    }
+    for (uint32_t i = 0; i < 5000; i += 7) {
+        reg.disable<visible>(entities[i]);
+    }
+    for (uint32_t i = 3; i < 5000; i += 11) {
+        reg.destroy_deferred(entities[i]);
+    }
+
+    auto masked = reg.view<const s1&, const visible&>();
+    auto masked_parts = masked.split(6);
+    std::size_t masked_rows = 0;
+    bool balanced = masked_parts.size() == 6;
+    for (const auto& part : masked_parts) {
+        std::size_t visited = 0;
+        for (const auto& [ref_s1, ref_visible] : part.each()) {
+            visited += ref_s1.i1 == ref_visible.layer;
+        }
+        balanced = balanced && visited == part.size() && part.size() + 1 >= masked.size() / 6 && part.size() <= masked.size() / 6 + 1;
+        masked_rows += visited;
+    }
+
+    auto parts = reg.view<s1&>().split(4);
+    std::vector<std::thread> workers;
+    for (const auto& part : parts) {
+        workers.emplace_back([&part] {
+            part.each([](s1& ref_s1) { ref_s1.i2++; });
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    bool once = true;
+    std::size_t rows = 0;
+    for (auto [ref_s1] : reg.view<const s1&>().each()) {
+        once = once && ref_s1.i2 == 1;
+        rows++;
+    }
+
+    auto tiny = reg.view<const s3&>().split(1000);
+    const auto non_empty = std::ranges::count_if(tiny, [](const auto& part) { return !part.empty(); });
+    bool threw = false;
+    try {
+        static_cast<void>(reg.view<const s3&>().split(0));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    return balanced && masked_rows == masked.size() && once && rows == reg.view<const s1&>().size()
+        && non_empty == 300 && threw;
+}
+
 int main() {
     ecs::registry reg;
     std::vector<std::function<bool(ecs::registry& reg)>> test_functions = {
-        test_create, test_delete, test_get, test_has, test_view, test_func, test_size
+        test_create, test_delete, test_get, test_has, test_view, test_func, test_size, test_checkpoint,
+        test_checkpoint_crash, test_compression, test_failed_decompression, test_dirty_decompression, test_flags, test_enable, test_group, test_component_ids,
+        test_modify, test_create_in_place, test_lanes, test_split,
+        test_large, test_fixed_capacity, test_rehash,
+        test_batched_find, test_concurrent_map,
+        test_sparse_map, test_lazy_destroy, test_destroy_if,
+        test_declare, test_chunk_directory, test_join,
+        test_reactive, test_replica, test_split_view
     };
     uint32_t passed = 0;
 
@@ -1,12 +1,23 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <span>
+#include <tuple>
 #include <type_traits>
 #include <sstream>
 
 #include "entity.hpp"
 #include "component.hpp"
 #include "sparse_map.hpp"
+#include "storage.hpp"
+#include "codec.hpp"
 
 namespace ecs {
 
@@ -14,9 +25,138 @@ namespace ecs {
     struct block_metadata {
         std::size_t offset{};
         component_meta meta{};
+        /// @brief Position of the column in the chunk layout
+        std::size_t column{};
+        /// @brief Version of the last change to this column in any chunk of the archetype. Chunks
+        /// share the layout read-only, so the stamp is mutable.
+        mutable std::uint64_t version{};
 
-        block_metadata(std::size_t offset, const component_meta& meta) noexcept
-            : offset(offset), meta(meta) {}
+        block_metadata(std::size_t offset, const component_meta& meta, std::size_t column = 0) noexcept
+            : offset(offset), meta(meta), column(column) {}
+    };
+
+    /// @brief Pointer-like iterator over the bits of a flag component column
+    ///
+    /// @tparam C Flag component type
+    /// @tparam is_const Whether the referenced bits are read-only
+    template<typename C, bool is_const>
+    class bit_pointer {
+        public:
+            using word_type = std::conditional_t<is_const, const std::uint64_t, std::uint64_t>;
+
+            constexpr bit_pointer() = default;
+
+            constexpr bit_pointer(word_type* words, std::size_t index) noexcept : words_(words), index_(index) {}
+
+            constexpr bit_reference<C, is_const> operator*() const noexcept {
+                return { words_ + index_ / 64U, std::uint64_t{ 1 } << (index_ % 64U) };
+            }
+
+            constexpr bit_pointer& operator++() noexcept {
+                ++index_;
+                return *this;
+            }
+
+            constexpr bit_pointer operator++(int) noexcept {
+                bit_pointer tmp(*this);
+                ++index_;
+                return tmp;
+            }
+
+            constexpr bit_pointer& operator+=(std::size_t n) noexcept {
+                index_ += n;
+                return *this;
+            }
+
+            constexpr auto operator<=>(const bit_pointer& rhs) const noexcept = default;
+
+        private:
+            word_type* words_{};
+            std::size_t index_{};
+    };
+
+    /// @brief Pointer-like iterator over the components of a lane component column
+    ///
+    /// @tparam C Lane component type
+    /// @tparam is_const Whether the referenced components are read-only
+    template<typename C, bool is_const>
+    class lane_pointer {
+        public:
+            using block_type = std::conditional_t<is_const, const lane_block<C>, lane_block<C>>;
+
+            static constexpr std::size_t lanes = lane_block<C>::lanes;
+
+            constexpr lane_pointer() = default;
+
+            constexpr lane_pointer(block_type* blocks, std::size_t index) noexcept : blocks_(blocks), index_(index) {}
+
+            constexpr lane_reference<C, is_const> operator*() const noexcept {
+                return { blocks_ + index_ / lanes, index_ % lanes };
+            }
+
+            constexpr lane_pointer& operator++() noexcept {
+                ++index_;
+                return *this;
+            }
+
+            constexpr lane_pointer operator++(int) noexcept {
+                lane_pointer tmp(*this);
+                ++index_;
+                return tmp;
+            }
+
+            constexpr lane_pointer& operator+=(std::size_t n) noexcept {
+                index_ += n;
+                return *this;
+            }
+
+            constexpr auto operator<=>(const lane_pointer& rhs) const noexcept = default;
+
+        private:
+            block_type* blocks_{};
+            std::size_t index_{};
+    };
+
+    /// @brief Pointer-like iterator over the components of a split component column
+    ///
+    /// @tparam C Split component type
+    /// @tparam is_const Whether the referenced components are read-only
+    template<typename C, bool is_const>
+    class field_pointer {
+        public:
+            using byte_type = std::conditional_t<is_const, const std::byte, std::byte>;
+
+            constexpr field_pointer() = default;
+
+            constexpr field_pointer(byte_type* column, std::size_t capacity, std::size_t index) noexcept
+                : column_(column), capacity_(capacity), index_(index) {}
+
+            constexpr field_reference<C, is_const> operator*() const noexcept {
+                return { column_, capacity_, index_ };
+            }
+
+            constexpr field_pointer& operator++() noexcept {
+                ++index_;
+                return *this;
+            }
+
+            constexpr field_pointer operator++(int) noexcept {
+                field_pointer tmp(*this);
+                ++index_;
+                return tmp;
+            }
+
+            constexpr field_pointer& operator+=(std::size_t n) noexcept {
+                index_ += n;
+                return *this;
+            }
+
+            constexpr auto operator<=>(const field_pointer& rhs) const noexcept = default;
+
+        private:
+            byte_type* column_{};
+            std::size_t capacity_{};
+            std::size_t index_{};
     };
 
     /// @brief Chunk holds a 16 Kb block of memory that holds components in blocks:
@@ -29,12 +169,46 @@ namespace ecs {
             /// @brief Chunk size in bytes
             static constexpr std::size_t mem_block_size = static_cast<const std::size_t>(16U * 1024);
 
+            /// @brief Size of blocks tiny archetypes start with, regions of this size are packed
+            /// into shared mem_block_size slabs
+            static constexpr std::size_t small_mem_block_size = mem_block_size / 8;
+
             /// @brief Block allocation alignment
             static constexpr std::size_t alloc_alignment = alignof(entity);
 
-            mem_block(const sparse_map<component_id_t, block_metadata>& mem_blocks_info, std::size_t max_size) 
-                : mem_blocks_info_(&mem_blocks_info), max_size_(max_size),
-                  buffer_(reinterpret_cast<std::byte*>(std::malloc(mem_block_size))) {}
+            /// @brief Number of columns with their own change version per chunk
+            static constexpr std::size_t tracked_columns = 16;
+
+            mem_block(const sparse_map<component_id_t, block_metadata>& mem_blocks_info, const component_index& index,
+                std::size_t max_size, block_storage& storage = heap_storage::instance(), std::size_t block_size = mem_block_size)
+                : mem_block(mem_blocks_info, index, max_size, storage, block_size, allocate_or_throw(storage, block_size)) {}
+
+            /// @brief Construct a block around a buffer already obtained from storage, for callers
+            /// that have to handle exhaustion without exceptions
+            /// @param buffer non-null buffer of block_size bytes allocated from storage
+            mem_block(const sparse_map<component_id_t, block_metadata>& mem_blocks_info, const component_index& index,
+                std::size_t max_size, block_storage& storage, std::size_t block_size, std::byte* buffer) noexcept
+                : mem_blocks_info_(&mem_blocks_info), index_(&index), max_size_(max_size), storage_(&storage), block_size_(block_size),
+                  buffer_(buffer) {
+                assert((buffer_ != nullptr) && "Memory block needs a buffer");
+                // flag columns are kept zeroed past the last entity so whole words can be counted
+                for (const auto& block : mem_blocks_info_->values()) {
+                    if (block.meta.type->bit_packed) {
+                        std::memset(buffer_ + block.offset, 0, column_size(block.meta, max_size_));
+                    }
+                }
+            }
+
+            /// @brief Construct a block around a buffer that already holds size rows in this layout,
+            /// e.g. one recovered from a storage file. Nothing is initialized.
+            /// @param buffer non-null buffer of block_size bytes allocated from storage
+            /// @param size number of rows in the buffer
+            mem_block(const sparse_map<component_id_t, block_metadata>& mem_blocks_info, const component_index& index,
+                std::size_t max_size, block_storage& storage, std::size_t block_size, std::byte* buffer, std::size_t size) noexcept
+                : buffer_(buffer), max_size_(max_size), number_of_elements_(size), mem_blocks_info_(&mem_blocks_info), index_(&index),
+                  storage_(&storage), block_size_(block_size) {
+                assert((buffer_ != nullptr && size <= max_size) && "Memory block needs a buffer with at most max_size rows");
+            }
 
             // delete copy constructor and copy assignment operator
             mem_block(const mem_block& rhs) = delete;
@@ -42,16 +216,36 @@ namespace ecs {
 
             /// @brief move constructor 
             mem_block(mem_block&& rhs) noexcept
-                : buffer_(rhs.buffer_), number_of_elements_(rhs.number_of_elements_), max_size_(rhs.max_size_), mem_blocks_info_(rhs.mem_blocks_info_) {
+                : buffer_(rhs.buffer_), number_of_elements_(rhs.number_of_elements_), max_size_(rhs.max_size_), mem_blocks_info_(rhs.mem_blocks_info_),
+                  index_(rhs.index_), storage_(rhs.storage_), block_size_(rhs.block_size_), compressed_(std::move(rhs.compressed_)),
+                  packed_(rhs.packed_.load(std::memory_order_relaxed)), idle_frames_(rhs.idle_frames_.load(std::memory_order_relaxed)),
+                  tombstones_(std::move(rhs.tombstones_)), dead_count_(rhs.dead_count_),
+                  versions_(rhs.versions_) {
                 rhs.buffer_ = nullptr;
+                rhs.dead_count_ = 0;
             }
 
             /// @brief move assignment operator
             mem_block& operator=(mem_block&& rhs) noexcept {
+                if (this == &rhs) {
+                    return *this;
+                }
+                if (buffer_ != nullptr) {
+                    storage_->deallocate(buffer_, block_size_);
+                }
                 buffer_ = rhs.buffer_;
                 number_of_elements_ = rhs.number_of_elements_;
                 max_size_ = rhs.max_size_;
                 mem_blocks_info_ = rhs.mem_blocks_info_;
+                index_ = rhs.index_;
+                storage_ = rhs.storage_;
+                block_size_ = rhs.block_size_;
+                compressed_ = std::move(rhs.compressed_);
+                packed_.store(rhs.packed_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                idle_frames_.store(rhs.idle_frames_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                tombstones_ = std::move(rhs.tombstones_);
+                dead_count_ = std::exchange(rhs.dead_count_, 0);
+                versions_ = rhs.versions_;
                 rhs.buffer_ = nullptr;
                 return *this;
             }
@@ -61,21 +255,69 @@ namespace ecs {
                     return;
                 }
 
-                for(const auto& [id, block_md] : *mem_blocks_info_) {
+                for (const auto& block_md : mem_blocks_info_->values()) {
                     for(std::size_t i = 0; i < number_of_elements_; ++i) {
-                        //TODO investigate why this causes crash
-                        //block_md.meta.type->destruct(buffer_ + block_md.offset + i * block_md.meta.type->size);
+                        destroy_element(block_md, i);
                     }
                 }
 
-                std::free(buffer_);
+                storage_->deallocate(buffer_, block_size_);
             }
 
             template<component... Args>
             void emplace_back(entity ent, Args&&... args) {
                 assert((!full()) && "Memory block is full, cannot add another entity");
                 std::construct_at(buffer_ptr<entity>(size()), ent);
-                (..., std::construct_at(mut_ptr<Args>(size()), std::move(args)));
+                (..., construct_component<Args>(size(), std::forward<Args>(args)));
+                (..., enable_component<std::decay_t<Args>>(size()));
+                number_of_elements_++;
+            }
+
+            /// @brief Append an entity constructing every component in place from a tuple of
+            /// constructor arguments
+            /// @param ent entity
+            /// @param args one tuple of constructor arguments per component
+            template<component... Args, typename... Tuples>
+            void emplace_back_piecewise(entity ent, Tuples&&... args) {
+                assert((!full()) && "Memory block is full, cannot add another entity");
+                std::construct_at(buffer_ptr<entity>(size()), ent);
+                (..., construct_component_from<Args>(size(), std::forward<Tuples>(args)));
+                (..., enable_component<Args>(size()));
+                number_of_elements_++;
+            }
+
+            /// @brief Append an entity leaving its components default initialized, i.e. with
+            /// indeterminate values for trivial types. The caller fills them in directly.
+            /// @param ent entity
+            template<component... Args>
+                requires(std::is_trivially_default_constructible_v<Args> && ...)
+            void emplace_back_uninitialized(entity ent) {
+                assert((!full()) && "Memory block is full, cannot add another entity");
+                std::construct_at(buffer_ptr<entity>(size()), ent);
+                (..., ::new (static_cast<void*>(mut_ptr<Args>(size()))) Args);
+                (..., enable_component<Args>(size()));
+                number_of_elements_++;
+            }
+
+            /// @brief Append a row moved from another block with a different layout. Columns present
+            /// in both blocks are move constructed from src, the given components are constructed in
+            /// place. The row in src is left moved from and has to be erased by the caller.
+            /// @param src block holding the row
+            /// @param src_index index of the row in src
+            /// @param args components not present in src
+            template<component... Args>
+            void emplace_back_from(mem_block& src, std::size_t src_index, Args&&... args) {
+                assert((!full()) && "Memory block is full, cannot add another entity");
+                ensure_resident();
+                src.ensure_resident();
+                for (const auto& [id, block] : *mem_blocks_info_) {
+                    auto other = src.mem_blocks_info_->find(id);
+                    if (other != src.mem_blocks_info_->end()) {
+                        move_element(block, size(), src, other->second, src_index, false);
+                    }
+                }
+                (..., construct_component<Args>(size(), std::forward<Args>(args)));
+                (..., enable_component<std::decay_t<Args>>(size()));
                 number_of_elements_++;
             }
 
@@ -83,43 +325,371 @@ namespace ecs {
             /// @param index index of entity
             /// @param other mem_block of last entity
             /// @return std::optional<entity>
-            std::optional<entity> erase_and_fill(std::size_t index, mem_block& other) noexcept {
+            /// @throws std::bad_alloc if a compressed block cannot be decompressed, nothing is erased then
+            std::optional<entity> erase_and_fill(std::size_t index, mem_block& other) {
                 assert((index < number_of_elements_) && "Entity index exeeds known size");
                 if(number_of_elements_ == 1 || index == number_of_elements_ - 1) { // index points to last element => nothing has to be filled
                     delete_last_entity();
                     return std::nullopt;
                 }
                 assert((!other.empty()) && "Other memory block is empty, cannot move entity");
+                ensure_resident();
+                other.ensure_resident();
                 const std::size_t other_mem_block_index = other.size() - 1;
                 entity ent = *other.buffer_ptr<entity>(other_mem_block_index);
+                const bool moved_dead = other.dead(other_mem_block_index);
                 //iterate over all component_blocks inside mem_block and move them to freed spot
-                for (const auto& [id, block] : *mem_blocks_info_) {
-                    auto other_block = other.mem_blocks_info_->find(id)->second;
-                    const auto* type = block.meta.type;
-                    auto* ptr = other.buffer_ + other_block.offset + other_mem_block_index * type->size;
-                    type->move_assign(buffer_ + block.offset + index * type->size, ptr);
+                if (other.mem_blocks_info_ == mem_blocks_info_) {
+                    // same layout, the columns line up without looking them up
+                    for (const auto& block : mem_blocks_info_->values()) {
+                        move_element(block, index, other, block, other_mem_block_index, true);
+                    }
+                } else {
+                    for (const auto& [id, block] : *mem_blocks_info_) {
+                        const auto& other_block = other.mem_blocks_info_->find(id)->second;
+                        move_element(block, index, other, other_block, other_mem_block_index, true);
+                    }
                 }
                 other.delete_last_entity();
+                // a dead row stays dead at its new place until the next compaction
+                set_dead(index, moved_dead);
                 return ent;
             }
 
-            void delete_last_entity() noexcept {
+            /// @brief Move all entities out of other into this empty block, leaving other empty.
+            /// Used when an archetype moves its rows into a block with a different layout.
+            /// @param other block to take entities from
+            /// @param other_info layout of other
+            void take(mem_block& other, const sparse_map<component_id_t, block_metadata>& other_info) {
+                assert(empty() && "Memory block must be empty to take entities");
+                assert((other.size() <= max_size()) && "Memory block is too small to take entities");
+                ensure_resident();
+                other.ensure_resident();
+                for (const auto& [id, block] : *mem_blocks_info_) {
+                    const auto& other_block = other_info.find(id)->second;
+                    for (std::size_t i = 0; i < other.number_of_elements_; ++i) {
+                        move_element(block, i, other, other_block, i, false);
+                        other.destroy_element(other_block, i);
+                    }
+                }
+                number_of_elements_ = other.number_of_elements_;
+                other.number_of_elements_ = 0;
+                if (other.dead_count_ != 0) {
+                    tombstones_ = std::move(other.tombstones_);
+                    tombstones_.resize((max_size_ + 63U) / 64U);
+                    dead_count_ = std::exchange(other.dead_count_, 0);
+                }
+            }
+
+            /// @brief Mark the row at index dead. It keeps its place and components until the owning
+            /// archetype is compacted, views skip it meanwhile.
+            /// @param index index of a live row
+            void kill(std::size_t index) {
+                assert((index < number_of_elements_) && "Entity index exeeds known size");
+                set_dead(index, true);
+            }
+
+            /// @brief Allocate the tombstone mask ahead of the first kill(), which then does not allocate
+            void reserve_tombstones() {
+                tombstones_.resize((max_size_ + 63U) / 64U);
+            }
+
+            /// @brief Check if the row at index has been killed
+            [[nodiscard]] bool dead(std::size_t index) const noexcept {
+                return dead_count_ != 0 && ((tombstones_[index / 64U] >> (index % 64U)) & 1U);
+            }
+
+            /// @brief Number of dead rows
+            [[nodiscard]] std::size_t dead_count() const noexcept {
+                return dead_count_;
+            }
+
+            /// @brief Tombstone mask, one bit per row, nullptr while no row is dead
+            [[nodiscard]] const std::uint64_t* tombstones() const noexcept {
+                return dead_count_ != 0 ? tombstones_.data() : nullptr;
+            }
+
+            /// @brief Destroy the components of all dead rows, leaving raw slots for compaction
+            void destroy_dead() {
+                if (dead_count_ == 0) {
+                    return;
+                }
+                ensure_resident();
+                for (std::size_t i = 0; i < number_of_elements_; ++i) {
+                    if (dead(i)) {
+                        destroy_at(i);
+                    }
+                }
+            }
+
+            /// @brief Move construct count rows starting at src_index of src, a block with the same
+            /// layout, into the raw slots starting at index and destroy the source rows. Columns are
+            /// moved one at a time, trivially copyable ones with a single memmove. The ranges may
+            /// overlap if src is this block and index < src_index.
+            /// @param index first destination row, the slots must not hold constructed components
+            /// @param src source block
+            /// @param src_index first source row
+            /// @param count number of rows
+            void relocate(std::size_t index, mem_block& src, std::size_t src_index, std::size_t count = 1) {
+                assert((src.mem_blocks_info_ == mem_blocks_info_) && "Blocks must share the layout");
+                assert((&src != this || index <= src_index) && "Rows can only move forward within a block");
+                ensure_resident();
+                src.ensure_resident();
+                for (const auto& block : mem_blocks_info_->values()) {
+                    const auto* type = block.meta.type;
+                    if (type->trivially_copyable && !type->bit_packed && !type->scattered()) {
+                        std::memmove(buffer_ + block.offset + index * type->size,
+                            src.buffer_ + block.offset + src_index * type->size, count * type->size);
+                        continue;
+                    }
+                    for (std::size_t i = 0; i < count; ++i) {
+                        move_element(block, index + i, src, block, src_index + i, false);
+                        src.destroy_element(block, src_index + i);
+                    }
+                }
+            }
+
+            /// @brief Set the row count after compaction and forget all tombstones. Rows from size on
+            /// must already have been destroyed or relocated.
+            /// @param size new number of rows
+            void truncate(std::size_t size) noexcept {
+                assert((size <= max_size_) && "Size exceeds the block capacity");
+                number_of_elements_ = size;
+                std::ranges::fill(tombstones_, 0U);
+                dead_count_ = 0;
+            }
+
+            void delete_last_entity() {
                 assert((!empty()) && "Memory block is empty, cannot destroy last entity");
+                ensure_resident();
                 number_of_elements_--;
                 destroy_at(number_of_elements_);
+                set_dead(number_of_elements_, false);
             }
 
             template<component T>
             inline T* mut_ptr(std::size_t index) {
                 static_assert(!std::is_same_v<T, entity>, "Cannot give a mutable pointer/reference to the entity");
+                static_assert(!flag_component<T>, "Flag components are bit packed, use mut_bit_ptr");
+                static_assert(!lane_component<T>, "Lane components are stored in lane blocks, use mut_lane_ptr");
+                static_assert(!split_component<T>, "Split components are stored member wise, use mut_field_ptr");
                 return buffer_ptr_impl<T*>(*this, index);
             }
 
             template<component T>
             inline const T* const_ptr(std::size_t index) const {
+                static_assert(!flag_component<T>, "Flag components are bit packed, use const_bit_ptr");
+                static_assert(!lane_component<T>, "Lane components are stored in lane blocks, use const_lane_ptr");
+                static_assert(!split_component<T>, "Split components are stored member wise, use const_field_ptr");
                 return buffer_ptr_impl<const T*>(*this, index);
             }
 
+            template<flag_component T>
+            inline bit_pointer<T, false> mut_bit_ptr(std::size_t index) {
+                return { buffer_ptr_impl<std::uint64_t*, T>(*this, 0), index };
+            }
+
+            template<flag_component T>
+            inline bit_pointer<T, true> const_bit_ptr(std::size_t index) const {
+                return { buffer_ptr_impl<const std::uint64_t*, T>(*this, 0), index };
+            }
+
+            template<lane_component T>
+            inline lane_pointer<T, false> mut_lane_ptr(std::size_t index) {
+                return { buffer_ptr_impl<lane_block<T>*, T>(*this, 0), index };
+            }
+
+            template<lane_component T>
+            inline lane_pointer<T, true> const_lane_ptr(std::size_t index) const {
+                return { buffer_ptr_impl<const lane_block<T>*, T>(*this, 0), index };
+            }
+
+            /// @brief Lane blocks of a lane component column covering all entities of the block. Lanes
+            /// of the last block past size() hold unspecified values.
+            /// @tparam T Lane component type
+            /// @return std::span<lane_block<T>>
+            template<lane_component T>
+            [[nodiscard]] std::span<lane_block<T>> lane_blocks() {
+                return { buffer_ptr_impl<lane_block<T>*, T>(*this, 0), (size() + lane_block<T>::lanes - 1U) / lane_block<T>::lanes };
+            }
+
+            template<lane_component T>
+            [[nodiscard]] std::span<const lane_block<T>> lane_blocks() const {
+                return { buffer_ptr_impl<const lane_block<T>*, T>(*this, 0), (size() + lane_block<T>::lanes - 1U) / lane_block<T>::lanes };
+            }
+
+            template<split_component T>
+            inline field_pointer<T, false> mut_field_ptr(std::size_t index) {
+                return { buffer_ptr_impl<std::byte*, T>(*this, 0), max_size_, index };
+            }
+
+            template<split_component T>
+            inline field_pointer<T, true> const_field_ptr(std::size_t index) const {
+                return { buffer_ptr_impl<const std::byte*, T>(*this, 0), max_size_, index };
+            }
+
+            /// @brief Sub-column of a single member of a split component, covering all entities of
+            /// the block
+            /// @tparam Member Pointer to the member, e.g. &transform::pos
+            /// @return std::span of the member type
+            template<auto Member>
+            [[nodiscard]] auto field_column() {
+                using C = typename detail::member_pointer_traits<decltype(Member)>::class_type;
+                constexpr auto index = split_column<C>::template index_of<Member>();
+                static_assert(index < split_column<C>::fields, "Member is not listed in split_members");
+                return std::span{ split_column<C>::template field<index>(buffer_ptr_impl<std::byte*, C>(*this, 0), max_size_), size() };
+            }
+
+            template<auto Member>
+            [[nodiscard]] auto field_column() const {
+                using C = typename detail::member_pointer_traits<decltype(Member)>::class_type;
+                constexpr auto index = split_column<C>::template index_of<Member>();
+                static_assert(index < split_column<C>::fields, "Member is not listed in split_members");
+                return std::span{ split_column<C>::template field<index>(buffer_ptr_impl<const std::byte*, C>(*this, 0), max_size_), size() };
+            }
+
+            /// @brief Words of a flag column covering all entities of the block, bits past the last
+            /// entity are zero. Allows processing 64 flags at a time.
+            /// @tparam T Flag component type
+            /// @return std::span<std::uint64_t>
+            template<flag_component T>
+            [[nodiscard]] std::span<std::uint64_t> bit_words() {
+                return { buffer_ptr_impl<std::uint64_t*, T>(*this, 0), (size() + 63U) / 64U };
+            }
+
+            template<flag_component T>
+            [[nodiscard]] std::span<const std::uint64_t> bit_words() const {
+                return { buffer_ptr_impl<const std::uint64_t*, T>(*this, 0), (size() + 63U) / 64U };
+            }
+
+            /// @brief Number of entities whose flag T is set
+            /// @tparam T Flag component type
+            /// @return std::size_t
+            template<flag_component T>
+            [[nodiscard]] std::size_t count() const {
+                std::size_t n = 0;
+                const auto* dead = tombstones();
+                for (std::size_t w = 0; const auto word : bit_words<T>()) {
+                    n += static_cast<std::size_t>(std::popcount(dead != nullptr ? word & ~dead[w] : word));
+                    w++;
+                }
+                return n;
+            }
+
+            /// @brief Compress the block contents column by column (byte shuffle + LZ) and release the
+            /// buffer. The block is transparently decompressed on the next access, also through const
+            /// access from several threads. Only blocks whose components are all trivially copyable
+            /// are compressed. Must not run concurrently with any access to the block.
+            /// @return true if the block has been compressed
+            bool compress() {
+                if (buffer_ == nullptr) {
+                    return false;
+                }
+                std::size_t raw_size = 0;
+                for (const auto& block : mem_blocks_info_->values()) {
+                    if (!block.meta.type->trivially_copyable) {
+                        return false;
+                    }
+                    const auto [count, size] = shuffle_geometry(block);
+                    raw_size += count * size;
+                }
+
+                auto& scratch = scratch_buffer();
+                scratch.resize(raw_size);
+                std::size_t position = 0;
+                for (const auto& block : mem_blocks_info_->values()) {
+                    const auto [count, size] = shuffle_geometry(block);
+                    codec::shuffle(buffer_ + block.offset, scratch.data() + position, count, size);
+                    position += count * size;
+                }
+
+                std::vector<std::byte> compressed;
+                compressed.reserve(raw_size / 2);
+                codec::compress(scratch.data(), raw_size, compressed);
+                if (compressed.size() >= block_size_) {
+                    return false;
+                }
+                compressed.shrink_to_fit();
+
+                compressed_ = std::move(compressed);
+                storage_->deallocate(buffer_, block_size_);
+                buffer_ = nullptr;
+                packed_.store(true, std::memory_order_release);
+                return true;
+            }
+
+            /// @brief Make sure the block is decompressed and mark it as accessed. Safe to call from
+            /// several threads: the first one to find the block compressed decompresses it, the
+            /// others wait for it.
+            /// @throws std::bad_alloc if no buffer is left for the decompressed rows
+            inline void ensure_resident() const {
+                // only written when set, so readers of a resident chunk do not contend on the line
+                if (idle_frames_.load(std::memory_order_relaxed) != 0) {
+                    idle_frames_.store(0, std::memory_order_relaxed);
+                }
+                if (packed_.load(std::memory_order_acquire)) [[unlikely]] {
+                    std::scoped_lock lock{ decompress_mutex() };
+                    if (packed_.load(std::memory_order_relaxed)) {
+                        decompress();
+                        packed_.store(false, std::memory_order_release);
+                    }
+                }
+            }
+
+            /// @brief Stamp the column of component id as changed at version, in this chunk and
+            /// archetype wide. No-op if the chunk has no such column.
+            /// @param id component ID
+            /// @param version change version, see archetype_registry::version
+            void mark_changed(component_id_t id, std::uint64_t version) noexcept {
+                if (auto iter = mem_blocks_info_->find(id); iter != mem_blocks_info_->end()) {
+                    mark_changed(iter->second, version);
+                }
+            }
+
+            /// @brief Stamp every column as changed at version, for rows being added, moved or removed
+            /// @param version change version
+            void mark_changed(std::uint64_t version) noexcept {
+                for (const auto& block : mem_blocks_info_->values()) {
+                    mark_changed(block, version);
+                }
+            }
+
+            /// @brief Version of the last change to the column of component id in this chunk
+            /// @param id component ID
+            /// @return std::uint64_t the version, 0 if the column never changed or does not exist
+            [[nodiscard]] std::uint64_t version(component_id_t id) const noexcept {
+                auto iter = mem_blocks_info_->find(id);
+                return iter != mem_blocks_info_->end() ? versions_[version_slot(iter->second)] : 0;
+            }
+
+            /// @brief Version of the last change to any column of this chunk
+            [[nodiscard]] std::uint64_t version() const noexcept {
+                return std::ranges::max(versions_);
+            }
+
+            /// @brief Give up the buffer without destroying the rows or returning it to the storage,
+            /// which keeps them, e.g. a storage file closed on shutdown
+            void detach() noexcept {
+                buffer_ = nullptr;
+            }
+
+            /// @brief Raw chunk buffer, decompressed first if needed
+            [[nodiscard]] const std::byte* data() const {
+                ensure_resident();
+                return buffer_;
+            }
+
+            /// @brief Column layout, shared by all chunks of the archetype
+            [[nodiscard]] const sparse_map<component_id_t, block_metadata>& layout() const noexcept {
+                return *mem_blocks_info_;
+            }
+
+            /// @brief Count another frame without access
+            /// @return number of frames since the block has been accessed last
+            std::size_t age() noexcept { return idle_frames_.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+            [[nodiscard]] constexpr std::size_t block_size() const noexcept { return block_size_; }
+            [[nodiscard]] bool compressed() const noexcept { return packed_.load(std::memory_order_acquire); }
             [[nodiscard]] constexpr std::size_t max_size() const noexcept { return max_size_; }
             [[nodiscard]] constexpr std::size_t size() const noexcept { return number_of_elements_; }
             [[nodiscard]] constexpr bool full() const noexcept { return size() == max_size(); }
@@ -128,19 +698,19 @@ namespace ecs {
         private:
 
             template<component T>
-            inline T* buffer_ptr(std::size_t index) noexcept {
+            inline T* buffer_ptr(std::size_t index) {
                 return buffer_ptr_impl<T*>(*this, index);
             }
 
             template<component T>
-            [[nodiscard]] inline const T* buffer_ptr(std::size_t index) const noexcept {
+            [[nodiscard]] inline const T* buffer_ptr(std::size_t index) const {
                 return buffer_ptr_impl<const T*>(*this, index);
             }
 
-            template<typename P>
+            template<typename P, typename component_type = std::remove_const_t<std::remove_pointer_t<P>>>
             static inline P buffer_ptr_impl(auto&& self, std::size_t index) {
-                using component_type = std::remove_const_t<std::remove_pointer_t<P>>;
-                const auto& block = self.get_block(component_id::value<component_type>);
+                self.ensure_resident();
+                const auto& block = self.get_block(self.index_->template find<component_type>());
                 return (reinterpret_cast<P>(self.buffer_ + block.offset) + index);
             }
 
@@ -148,30 +718,225 @@ namespace ecs {
                 return mem_blocks_info_->at(id);
             }
 
-            inline void destroy_at(std::size_t index) noexcept {
-                for(const auto& [id, block] : *mem_blocks_info_) {
-                    block.meta.type->destruct(buffer_ + block.offset + index * block.meta.type->size);
+            inline void destroy_at(std::size_t index) {
+                ensure_resident();
+                for (const auto& block : mem_blocks_info_->values()) {
+                    destroy_element(block, index);
+                }
+            }
+
+            template<component T>
+            inline void construct_component(std::size_t index, T&& value) {
+                if constexpr (flag_component<std::decay_t<T>>) {
+                    *mut_bit_ptr<std::decay_t<T>>(index) = value.value;
+                } else if constexpr (lane_component<std::decay_t<T>>) {
+                    *mut_lane_ptr<std::decay_t<T>>(index) = value;
+                } else if constexpr (split_component<std::decay_t<T>>) {
+                    *mut_field_ptr<std::decay_t<T>>(index) = value;
+                } else {
+                    std::construct_at(mut_ptr<std::decay_t<T>>(index), std::forward<T>(value));
                 }
             }
 
-            std::byte* buffer_{};
+            template<component T, typename Tuple>
+            inline void construct_component_from(std::size_t index, Tuple&& args) {
+                if constexpr (flag_component<T>) {
+                    // a flag is constructed from its bool value or from another flag
+                    *mut_bit_ptr<T>(index) = std::apply([](auto&&... a) -> bool {
+                        if constexpr (sizeof...(a) == 0) {
+                            return false;
+                        } else if constexpr (std::is_constructible_v<bool, decltype(a)...>) {
+                            return bool(a...);
+                        } else {
+                            return T(std::forward<decltype(a)>(a)...).value;
+                        }
+                    }, std::forward<Tuple>(args));
+                } else if constexpr (lane_component<T>) {
+                    *mut_lane_ptr<T>(index) = std::make_from_tuple<T>(std::forward<Tuple>(args));
+                } else if constexpr (split_component<T>) {
+                    *mut_field_ptr<T>(index) = std::make_from_tuple<T>(std::forward<Tuple>(args));
+                } else {
+                    std::apply([ptr = mut_ptr<T>(index)](auto&&... a) {
+                        std::construct_at(ptr, std::forward<decltype(a)>(a)...);
+                    }, std::forward<Tuple>(args));
+                }
+            }
+
+            template<component T>
+            inline void enable_component(std::size_t index) {
+                if constexpr (enableable_component<T>) {
+                    *mut_bit_ptr<enabled_flag<T>>(index) = true;
+                }
+            }
+
+            /// @brief Move construct or assign a single element of a column from another block
+            inline void move_element(const block_metadata& block, std::size_t index,
+                const mem_block& src, const block_metadata& src_block, std::size_t src_index, bool assign) noexcept {
+                const auto* type = block.meta.type;
+                if (type->bit_packed) {
+                    assign_bit(buffer_ + block.offset, index, test_bit(src.buffer_ + src_block.offset, src_index));
+                    return;
+                }
+                if (type->scattered()) {
+                    type->element_copy(buffer_ + block.offset, max_size_, index, src.buffer_ + src_block.offset, src.max_size_, src_index);
+                    return;
+                }
+                auto* from = src.buffer_ + src_block.offset + src_index * type->size;
+                auto* to = buffer_ + block.offset + index * type->size;
+                if (assign) {
+                    type->move_assign(to, from);
+                } else {
+                    type->move_construct(to, from);
+                }
+            }
+
+            /// @brief Destroy a single element of a column, flag bits are cleared
+            inline void destroy_element(const block_metadata& block, std::size_t index) noexcept {
+                if (block.meta.type->bit_packed) {
+                    assign_bit(buffer_ + block.offset, index, false);
+                    return;
+                }
+                if (block.meta.type->scattered()) {
+                    // lane and split components are trivially copyable, nothing to destroy
+                    return;
+                }
+                block.meta.type->destruct(buffer_ + block.offset + index * block.meta.type->size);
+            }
+
+            inline void set_dead(std::size_t index, bool value) noexcept {
+                if (tombstones_.empty()) {
+                    if (!value) {
+                        return;
+                    }
+                    tombstones_.resize((max_size_ + 63U) / 64U);
+                }
+                auto& word = tombstones_[index / 64U];
+                const auto mask = std::uint64_t{ 1 } << (index % 64U);
+                if (((word & mask) != 0) != value) {
+                    word ^= mask;
+                    value ? dead_count_++ : dead_count_--;
+                }
+            }
+
+            static inline bool test_bit(const std::byte* column, std::size_t index) noexcept {
+                return (reinterpret_cast<const std::uint64_t*>(column)[index / 64U] >> (index % 64U)) & 1U;
+            }
+
+            static inline void assign_bit(std::byte* column, std::size_t index, bool value) noexcept {
+                auto& word = reinterpret_cast<std::uint64_t*>(column)[index / 64U];
+                const auto mask = std::uint64_t{ 1 } << (index % 64U);
+                word = value ? (word | mask) : (word & ~mask);
+            }
+
+            void decompress() const {
+                auto* buffer = storage_->allocate(block_size_);
+                if (buffer == nullptr) [[unlikely]] {
+                    throw std::bad_alloc{};
+                }
+
+                auto& scratch = scratch_buffer();
+                scratch.resize(block_size_);
+                codec::decompress(compressed_.data(), compressed_.size(), scratch.data());
+
+                std::size_t position = 0;
+                for (const auto& block : mem_blocks_info_->values()) {
+                    const auto [count, size] = shuffle_geometry(block);
+                    // only the bytes of the live rows were saved, keep flag columns zeroed past them
+                    if (block.meta.type->bit_packed) {
+                        std::memset(buffer + block.offset, 0, column_size(block.meta, max_size_));
+                    }
+                    codec::unshuffle(scratch.data() + position, buffer + block.offset, count, size);
+                    position += count * size;
+                }
+
+                buffer_ = buffer;
+                std::vector<std::byte>{}.swap(compressed_);
+            }
+
+            /// @brief Element count and size a column is shuffled with, flag and lane columns are plain
+            /// bytes. Split columns are laid out for max_size() entities and are taken whole.
+            [[nodiscard]] std::pair<std::size_t, std::size_t> shuffle_geometry(const block_metadata& block) const noexcept {
+                if (block.meta.type->split_size != nullptr) {
+                    return { column_size(block.meta, max_size_), 1 };
+                }
+                if (block.meta.type->bit_packed || block.meta.type->lanes != 0) {
+                    return { column_size(block.meta, number_of_elements_), 1 };
+                }
+                return { number_of_elements_, block.meta.type->size };
+            }
+
+            /// @brief Columns past the last tracked one share its slot, which may report a change
+            /// of one of them spuriously but never misses one
+            static constexpr std::size_t version_slot(const block_metadata& block) noexcept {
+                return std::min(block.column, tracked_columns - 1);
+            }
+
+            void mark_changed(const block_metadata& block, std::uint64_t version) noexcept {
+                auto& slot = versions_[version_slot(block)];
+                slot = std::max(slot, version);
+                block.version = std::max(block.version, version);
+            }
+
+            static std::byte* allocate_or_throw(block_storage& storage, std::size_t size) {
+                auto* buffer = storage.allocate(size);
+                if (buffer == nullptr) [[unlikely]] {
+                    throw std::bad_alloc{};
+                }
+                return buffer;
+            }
+
+            /// @brief Serializes decompression, shared by all blocks since it is rare and a mutex per
+            /// block would make blocks immovable
+            static std::mutex& decompress_mutex() {
+                static std::mutex mutex{};
+                return mutex;
+            }
+
+            static std::vector<std::byte>& scratch_buffer() {
+                thread_local std::vector<std::byte> scratch{};
+                return scratch;
+            }
+
+            mutable std::byte* buffer_{};
             std::size_t max_size_{}, number_of_elements_{};
             const sparse_map<component_id_t, block_metadata>* mem_blocks_info_;
+            const component_index* index_{};
+            block_storage* storage_{};
+            std::size_t block_size_{};
+            mutable std::vector<std::byte> compressed_{};
+            // set while the contents only exist in compressed_, buffer_ and compressed_ are published
+            // through it to const accessors on other threads
+            mutable std::atomic<bool> packed_{};
+            mutable std::atomic<std::size_t> idle_frames_{};
+            std::vector<std::uint64_t> tombstones_{};
+            std::size_t dead_count_{};
+            // change versions of the first tracked_columns columns, kept inline so that creating a
+            // chunk does not allocate
+            std::array<std::uint64_t, tracked_columns> versions_{};
     };
 
     /// @brief namespace for fetching single component from memory block
     struct component_fetch {
         
-        /// @brief Fetches const pointer for component reference
+        /// @brief Fetches const pointer for component reference, a bit_pointer for flag components, a
+        /// lane_pointer for lane components and a field_pointer for split components
         /// @tparam C component type
         /// @param mb memory block
         /// @param index index
         /// @return const pointer to component
         template<component_reference C>
-        static const std::decay_t<C>* fetch_pointer(auto&& mb, std::size_t index) 
+        static auto fetch_pointer(auto&& mb, std::size_t index)
             requires(std::is_const_v<std::remove_reference_t<C>>) {
             try {
-                return mb.template const_ptr<std::decay_t<C>>(index);
+                if constexpr (flag_component<std::decay_t<C>>) {
+                    return mb.template const_bit_ptr<std::decay_t<C>>(index);
+                } else if constexpr (lane_component<std::decay_t<C>>) {
+                    return mb.template const_lane_ptr<std::decay_t<C>>(index);
+                } else if constexpr (split_component<std::decay_t<C>>) {
+                    return mb.template const_field_ptr<std::decay_t<C>>(index);
+                } else {
+                    return mb.template const_ptr<std::decay_t<C>>(index);
+                }
             } catch (const std::out_of_range&) {
                 std::stringstream ss;
                 ss << "Component \"" << meta_t::of<std::decay_t<C>>()->name << "\" not found";
@@ -179,16 +944,25 @@ namespace ecs {
             }
         }
 
-        /// @brief Fetches mutable pointer for component reference
+        /// @brief Fetches mutable pointer for component reference, a bit_pointer for flag components,
+        /// a lane_pointer for lane components and a field_pointer for split components
         /// @tparam C component type
         /// @param mb memory block
         /// @param index index
         /// @return mutable pointer to component
         template<component_reference C>
-        static std::decay_t<C>* fetch_pointer(auto&& mb, std::size_t index)
+        static auto fetch_pointer(auto&& mb, std::size_t index)
             requires(!std::is_const_v<std::remove_reference_t<C>>) {
             try {
-                return mb.template mut_ptr<std::decay_t<C>>(index);
+                if constexpr (flag_component<std::decay_t<C>>) {
+                    return mb.template mut_bit_ptr<std::decay_t<C>>(index);
+                } else if constexpr (lane_component<std::decay_t<C>>) {
+                    return mb.template mut_lane_ptr<std::decay_t<C>>(index);
+                } else if constexpr (split_component<std::decay_t<C>>) {
+                    return mb.template mut_field_ptr<std::decay_t<C>>(index);
+                } else {
+                    return mb.template mut_ptr<std::decay_t<C>>(index);
+                }
             } catch (const std::out_of_range&) {
                 std::stringstream ss;
                 ss << "Component \"" << meta_t::of<std::decay_t<C>>()->name << "\" not found";
@@ -203,23 +977,36 @@ namespace ecs {
 
             static constexpr bool is_const = const_component_references_v<Args...>;
 
+            /// @brief Number of enableable components in Args, rows with any of them disabled are skipped
+            static constexpr std::size_t mask_count = (std::size_t{} + ... + enableable_component<std::decay_t<Args>>);
+
             using mem_block_type = std::conditional_t<is_const, const mem_block&, mem_block&>;
 
+            using masks_type = std::array<const std::uint64_t*, mask_count>;
+
             /// @brief implements an iterator over memory blocks
             class mem_block_iterator {
                 public:
                     using iterator_concept = std::forward_iterator_tag;
                     using iterator_category = std::forward_iterator_tag;
                     using difference_type = int;
-                    using value_type = std::tuple<Args...>;
-                    using reference = std::tuple<Args...>;
+                    using value_type = std::tuple<component_reference_t<Args>...>;
+                    using reference = std::tuple<component_reference_t<Args>...>;
                     using element_type = reference;
 
                     constexpr mem_block_iterator() = default;
                     constexpr ~mem_block_iterator() = default;
 
-                    explicit constexpr mem_block_iterator(mem_block_type mb, std::size_t index = 0)
-                        : pointers_(std::make_tuple(component_fetch::fetch_pointer<Args>(mb, index)...)) {}
+                    /// @brief Iterator at row index of a chunk, visiting rows up to last
+                    explicit constexpr mem_block_iterator(mem_block_type mb, std::size_t index, std::size_t last)
+                        : pointers_(std::make_tuple(component_fetch::fetch_pointer<Args>(mb, index)...)), dead_(mb.tombstones()) {
+                        if (mask_count > 0 || dead_ != nullptr) {
+                            masks_ = enable_masks(mb);
+                            index_ = index;
+                            size_ = last;
+                            skip_disabled();
+                        }
+                    }
 
                     constexpr mem_block_iterator(const mem_block_iterator& rhs) noexcept = default;
                     constexpr mem_block_iterator& operator=(const mem_block_iterator& rhs) noexcept = default;
@@ -228,40 +1015,147 @@ namespace ecs {
 
                     constexpr mem_block_iterator& operator++() noexcept {
                         std::apply([](auto&&... args) { (args++, ...); }, pointers_);
+                        if (mask_count > 0 || dead_ != nullptr) {
+                            index_++;
+                            skip_disabled();
+                        }
                         return *this;
                     }
 
                     constexpr mem_block_iterator operator++(int) noexcept {
                         mem_block_iterator tmp(*this);
-                        std::apply([](auto&&... args) { (args++, ...); }, pointers_);
+                        ++*this;
                         return tmp;
                     }
 
                     constexpr reference operator*() const noexcept {
-                        return std::apply([](auto&&... args) { return std::make_tuple(std::ref(*args)...); }, pointers_);
+                        return std::apply([](auto&&... args) { return reference{ *args... }; }, pointers_);
                     }
 
                     constexpr auto operator<=>(const mem_block_iterator& rhs) const noexcept = default;
 
                 private:
-                    std::tuple<std::add_pointer_t<std::remove_reference_t<Args>>...> pointers_;
+                    /// @brief Advance to the next live row with all enable bits set, scanning the masks a
+                    /// word at a time. Bits past the last row are zero, so a chunk without enabled
+                    /// rows is skipped in size / 64 steps.
+                    constexpr void skip_disabled() noexcept {
+                        while (index_ < size_) {
+                            const auto bit = index_ % 64U;
+                            auto word = ~std::uint64_t{};
+                            for (const auto* mask : masks_) {
+                                word &= mask[index_ / 64U];
+                            }
+                            if (dead_ != nullptr) {
+                                word &= ~dead_[index_ / 64U];
+                            }
+                            word >>= bit;
+                            if (word != 0) {
+                                advance(static_cast<std::size_t>(std::countr_zero(word)));
+                                return;
+                            }
+                            advance(std::min<std::size_t>(64U - bit, size_ - index_));
+                        }
+                    }
+
+                    constexpr void advance(std::size_t n) noexcept {
+                        index_ += n;
+                        std::apply([n](auto&&... args) { ((args += n), ...); }, pointers_);
+                    }
+
+                    std::tuple<decltype(component_fetch::fetch_pointer<Args>(std::declval<mem_block_type>(), 0))...> pointers_;
+                    masks_type masks_{};
+                    const std::uint64_t* dead_{};
+                    std::size_t index_{}, size_{};
             };
 
-            explicit mem_block_view(mem_block_type mb) : mem_block_(mb) {}
+            explicit mem_block_view(mem_block_type mb) : mem_block_(mb), last_(mb.size()) {}
+
+            /// @brief View of the rows [first, last) of a chunk
+            mem_block_view(mem_block_type mb, std::size_t first, std::size_t last) : mem_block_(mb), first_(first), last_(last) {}
 
             constexpr mem_block_iterator begin() noexcept {
-                return mem_block_iterator(mem_block_, 0);
+                return mem_block_iterator(mem_block_, first_, last_);
             }
 
             constexpr mem_block_iterator end() noexcept {
-                return mem_block_iterator(mem_block_, mem_block_.size());
+                return mem_block_iterator(mem_block_, last_, last_);
             }
 
+            /// @brief Number of rows the view visits, dead rows and rows with a disabled component are
+            /// not counted
             const std::size_t size() const noexcept {
-                return mem_block_.size();
+                if (mask_count == 0 && mem_block_.dead_count() == 0) {
+                    return last_ - first_;
+                }
+                if (mask_count == 0 && first_ == 0 && last_ == mem_block_.size()) {
+                    return mem_block_.size() - mem_block_.dead_count();
+                }
+                const auto masks = enable_masks(mem_block_);
+                const auto* dead = mem_block_.tombstones();
+                std::size_t c = 0;
+                for (std::size_t w = first_ / 64U; w < (last_ + 63U) / 64U; ++w) {
+                    c += static_cast<std::size_t>(std::popcount(visible_rows(masks, dead, w)));
+                }
+                return c;
+            }
+
+            /// @brief Chunk row of the n-th row the view visits, counting from 0
+            /// @param n number of visited rows to skip
+            /// @return std::size_t row index, the end of the view if it visits n rows or fewer
+            [[nodiscard]] std::size_t nth_row(std::size_t n) const noexcept {
+                if (mask_count == 0 && mem_block_.dead_count() == 0) {
+                    return std::min(first_ + n, last_);
+                }
+                const auto masks = enable_masks(mem_block_);
+                const auto* dead = mem_block_.tombstones();
+                for (std::size_t w = first_ / 64U; w < (last_ + 63U) / 64U; ++w) {
+                    auto word = visible_rows(masks, dead, w);
+                    const auto count = static_cast<std::size_t>(std::popcount(word));
+                    if (n < count) {
+                        for (; n > 0; --n) {
+                            word &= word - 1;
+                        }
+                        return w * 64U + static_cast<std::size_t>(std::countr_zero(word));
+                    }
+                    n -= count;
+                }
+                return last_;
             }
 
         private:
+
+            /// @brief Rows of word w the view visits, as bits
+            [[nodiscard]] std::uint64_t visible_rows(const masks_type& masks, const std::uint64_t* dead, std::size_t w) const noexcept {
+                auto word = ~std::uint64_t{};
+                for (const auto* mask : masks) {
+                    word &= mask[w];
+                }
+                if (dead != nullptr) {
+                    word &= ~dead[w];
+                }
+                const auto begin = w * 64U;
+                if (first_ > begin) {
+                    word &= ~std::uint64_t{} << (first_ - begin);
+                }
+                if (last_ < begin + 64U) {
+                    word &= (std::uint64_t{ 1 } << (last_ - begin)) - 1;
+                }
+                return word;
+            }
+
+            static masks_type enable_masks(const mem_block& mb) {
+                masks_type masks{};
+                std::size_t m = 0;
+                auto collect = [&]<typename C>() {
+                    if constexpr (enableable_component<C>) {
+                        masks[m++] = mb.template bit_words<enabled_flag<C>>().data();
+                    }
+                };
+                (..., collect.template operator()<std::decay_t<Args>>());
+                return masks;
+            }
+
             mem_block_type mem_block_;
+            std::size_t first_{}, last_{};
     };
 }
\ No newline at end of file
@@ -4,10 +4,21 @@
 #include "component.hpp"
 #include "type_traits.hpp"
 #include "archetype.hpp"
+#include "group.hpp"
 
+#include <algorithm>
+#include <array>
 #include <bitset>
 #include <type_traits>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace ecs {
 
@@ -35,11 +46,181 @@ namespace ecs {
         static constexpr bool is_const = view_converter_t::view_arguments_t::is_const;
     };
 
+    /// @brief Limits of a fixed capacity registry. Everything the registry needs up to these limits
+    /// is allocated when it is constructed, afterwards try_create() reports running into a limit by
+    /// returning std::nullopt instead of allocating.
+    struct registry_config {
+        /// @brief Maximum number of entities, counting the ones destroyed with destroy_deferred()
+        /// until they are compacted
+        std::size_t max_entities{};
+        /// @brief Maximum number of archetypes
+        std::size_t max_archetypes{};
+        /// @brief Maximum number of chunks, over all archetypes
+        std::size_t max_chunks{};
+    };
+
     class registry {
 
         public:
 
-            template<component... Args>
+            registry() = default;
+
+            /// @brief Construct a fixed capacity registry for real-time use. Chunks come from an
+            /// arena of config.max_chunks mem_block_size blocks and the entity pool, entity map,
+            /// archetype map and chunk directories are preallocated, so try_create() and destroy()
+            /// do not allocate and run in bounded time. The first try_create() of a new component
+            /// combination builds its archetype, which does allocate: declare() it during initialization.
+            /// Sparse components, groups and archetypes whose rows need large chunks are not covered.
+            /// @param config registry limits
+            explicit registry(const registry_config& config)
+                : config_(config), arena_(std::make_unique<fixed_block_storage>(config.max_chunks, mem_block::mem_block_size)),
+                  archetype_registry_(*arena_, false) {
+                entity_pool_.reserve(config.max_entities);
+                entity_map_.reserve_dense(config.max_entities);
+                entity_map_.reserve_sparse(config.max_entities);
+                archetype_registry_.reserve(config.max_archetypes, config.max_chunks);
+            }
+
+            /// @brief Construct a registry whose chunk buffers are allocated from storage
+            /// @param storage chunk buffer storage, must outlive the registry
+            explicit registry(block_storage& storage) : archetype_registry_(storage) {}
+
+#ifdef ECS_HAS_MMAP
+            /// @brief Construct a registry persisted in a storage file. If the file holds a
+            /// checkpoint, its entities and archetypes are restored with their chunks mapped in
+            /// place, not copied: only the directory is read and validated. The registry
+            /// checkpoints when it is destroyed and leaves its chunks in the file, changes after the
+            /// last checkpoint are lost if the process dies.
+            /// Components of persisted archetypes have to be trivially copyable, sparse components
+            /// and groups are not persisted.
+            /// @param storage storage file, must outlive the registry
+            /// @param catalog components of the archetypes in the file, matched by type name
+            /// @throws std::runtime_error if the checkpoint is corrupt or does not match the catalog
+            explicit registry(mapped_file_storage& storage, const component_catalog& catalog = {})
+                : archetype_registry_(storage, false), file_(&storage) {
+                restore(catalog);
+                mark_committed();
+            }
+#endif
+
+            registry(const registry&) = delete;
+            registry& operator=(const registry&) = delete;
+
+            ~registry() {
+#ifdef ECS_HAS_MMAP
+                if (file_ != nullptr) {
+                    try {
+                        checkpoint();
+                    } catch (const std::exception&) {
+                        // the file keeps the previous checkpoint
+                    }
+                    detach_chunks();
+                }
+#endif
+            }
+
+            /// @brief Create an entity unless that would exceed the limits of a fixed capacity
+            /// registry: the entity limit, the archetype limit or the chunk arena. On a registry
+            /// without limits only running out of chunk storage is reported.
+            /// @tparam Args component types
+            /// @param args components
+            /// @return std::optional<entity> the entity or std::nullopt if a limit has been reached
+            template<archetype_component... Args>
+            std::optional<entity> try_create(Args&&... args) {
+                [[maybe_unused]] unique_types<Args...> uniqueness;
+
+                if (config_.max_entities != 0 && entity_pool_.used() >= config_.max_entities) {
+                    return std::nullopt;
+                }
+                auto archetype = archetype_registry_.find_archetype<Args...>();
+                if (archetype == nullptr) {
+                    if (config_.max_archetypes != 0 && archetype_registry_.size() >= config_.max_archetypes) {
+                        return std::nullopt;
+                    }
+                    try {
+                        archetype = archetype_registry_.ensure_archetype<Args...>();
+                    } catch (const std::bad_alloc&) {
+                        // no chunk left for the new archetype
+                        return std::nullopt;
+                    }
+                }
+                if (!archetype->reserve_row()) {
+                    return std::nullopt;
+                }
+
+                auto entity = entity_pool_.create();
+                auto location = archetype->template emplace_back<Args...>(entity, std::forward<Args>(args)...);
+                save_location(entity.id(), location);
+
+                return entity;
+            }
+
+            /// @brief Create the archetype of Components ahead of time, with its metadata and first
+            /// chunk, so creating the first such entity during a frame does not allocate one
+            /// @tparam Components component types
+            template<archetype_component... Components>
+            void declare() {
+                [[maybe_unused]] unique_types<Components...> uniqueness;
+                archetype_registry_.ensure_archetype<Components...>();
+            }
+
+            /// @brief Create the archetype of Components and the one its entities end up in after
+            /// adding Added and removing Removed, and cache the transition between them, see modify()
+            /// @tparam Components component types
+            /// @tparam Added added component types
+            /// @tparam Removed removed component types
+            template<archetype_component... Components, archetype_component... Added, archetype_component... Removed>
+            void declare(add<Added...> added, ecs::remove<Removed...> removed = {}) {
+                [[maybe_unused]] unique_types<Components...> uniqueness;
+                auto* base = archetype_registry_.ensure_archetype<Components...>();
+                archetype_registry_.ensure_archetype(*base, added, removed);
+            }
+
+            /// @brief Create the archetypes and transitions listed in a data file, see
+            /// archetype_registry::declare for the format. Call at startup so that no archetype is
+            /// created during gameplay.
+            /// @param in input stream
+            /// @param catalog names of the components used in the file
+            /// @return std::size_t number of archetypes created
+            std::size_t declare(std::istream& in, const component_catalog& catalog) {
+                return archetype_registry_.declare(in, catalog);
+            }
+
+            /// @brief Current change version. Chunk columns written through mutable views, get() or
+            /// structural changes are stamped with it, compare against a version remembered earlier
+            /// with view::changed and view::each_changed.
+            [[nodiscard]] std::uint64_t version() const noexcept {
+                return archetype_registry_.version();
+            }
+
+            /// @brief Start a new change version, writes from now on count as newer than version()
+            /// returned before
+            /// @return std::uint64_t the new version
+            std::uint64_t advance_version() noexcept {
+                return archetype_registry_.advance_version();
+            }
+
+            /// @brief Check whether the column of any Watched component changed after version since
+            /// in any archetype, without visiting chunks or entities
+            /// @tparam Watched component types
+            /// @param since change version
+            template<component... Watched>
+            [[nodiscard]] bool changed(std::uint64_t since) const {
+                for (const auto& [components, archetype] : archetype_registry_) {
+                    if ((... || (archetype->template version<Watched>() > since))) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /// @brief Number of archetypes, e.g. to check that gameplay did not create any after the
+            /// declarations
+            [[nodiscard]] std::size_t archetype_count() const noexcept {
+                return archetype_registry_.size();
+            }
+
+            template<archetype_component... Args>
             entity create(Args&&... args) {
                 [[maybe_unused]] unique_types<Args...> uniqueness;
 
@@ -51,29 +232,200 @@ namespace ecs {
                 return entity;
             }
 
+            /// @brief Create an entity constructing each component in place from its own tuple of
+            /// constructor arguments, no temporary is moved into the chunk.
+            /// reg.create<position, name>(std::piecewise_construct, std::forward_as_tuple(1, 2), std::forward_as_tuple("a"));
+            /// @tparam Args component types
+            /// @param args one tuple of constructor arguments per component
+            /// @return entity
+            template<archetype_component... Args, typename... Tuples>
+                requires(sizeof...(Args) == sizeof...(Tuples))
+            entity create(std::piecewise_construct_t, Tuples&&... args) {
+                [[maybe_unused]] unique_types<Args...> uniqueness;
+
+                auto entity = entity_pool_.create();
+                auto archetype = archetype_registry_.ensure_archetype<Args...>();
+                auto location = archetype->template emplace_back_piecewise<Args...>(entity, std::forward<Tuples>(args)...);
+                save_location(entity.id(), location);
+
+                return entity;
+            }
+
+            /// @brief Create an entity without initializing its components and return pointers to
+            /// them so they can be filled in directly in the chunk.
+            /// @tparam Args trivially default constructible component types
+            /// @return std::tuple<entity, Args*...> entity and pointers to its components, valid until
+            /// the next structural change
+            template<archetype_component... Args>
+                requires((std::is_trivially_default_constructible_v<Args> && !flag_component<Args> && !lane_component<Args>
+                    && !split_component<Args>) && ...)
+            std::tuple<entity, Args*...> create_uninitialized() {
+                [[maybe_unused]] unique_types<Args...> uniqueness;
+
+                auto entity = entity_pool_.create();
+                auto archetype = archetype_registry_.ensure_archetype<Args...>();
+                auto location = archetype->template emplace_back_uninitialized<Args...>(entity);
+                save_location(entity.id(), location);
+
+                return { entity, &archetype->template get<Args&>(location)... };
+            }
+
             void destroy(entity e) {
                 ensure_alive(e);
                 auto location = get_location(e.id());
 
                 auto moved = location.archetype->erase_and_fill(location);
                 remove_location(e.id());
+                for (auto& pool : pools_.values()) {
+                    pool->remove(e.id());
+                }
 
                 if(moved) { save_location(moved->id(), location); }
-                auto tmp = get_location(moved->id());
                 entity_pool_.recycle(e);
             }
 
-            [[nodiscard]] bool alive(entity e) noexcept {
+            /// @brief Destroy an entity lazily: its row is only marked dead in a per chunk tombstone
+            /// mask, views skip it and the handle stops being alive at once. The row is removed and the
+            /// ID becomes reusable at the next compact(). Use this for bursts of destroys, e.g. during
+            /// a frame, and compact at a sync point.
+            /// @param e entity
+            void destroy_deferred(entity e) {
+                ensure_alive(e);
+                const auto& location = get_location(e.id());
+                location.archetype->kill(location);
+                for (auto& pool : pools_.values()) {
+                    pool->remove(e.id());
+                }
+                entity_pool_.retire(e);
+            }
+
+            /// @brief Remove the rows of all entities destroyed with destroy_deferred(). Each archetype
+            /// is compacted in one order preserving pass, the locations of moved entities are updated
+            /// as they move and the IDs of removed ones are recycled together.
+            /// @return number of removed entities
+            std::size_t compact() {
+                std::size_t removed = 0;
+                for (auto& [components, archetype] : archetype_registry_) {
+                    removed += archetype->compact([this](entity moved, const entity_location& location) {
+                        save_location(moved.id(), location);
+                    });
+                }
+                for (auto id : entity_pool_.retired()) {
+                    remove_location(id);
+                }
+                entity_pool_.reclaim();
+                return removed;
+            }
+
+            /// @brief Destroy all entities with the Query components for which pred returns true. The
+            /// predicate is evaluated chunk by chunk on the component references, disabled components
+            /// included, then the surviving rows of each archetype are compacted in one forward pass
+            /// and the IDs of the destroyed entities are recycled together, see compact(). Rows left
+            /// over by destroy_deferred() are removed along the way.
+            /// @tparam Query component references passed to pred
+            /// @param pred predicate, called as pred(Query...)
+            /// @return number of destroyed entities
+            template<component_reference... Query>
+            std::size_t destroy_if(auto&& pred) {
+                std::size_t destroyed = 0;
+                for (auto& [components, archetype] : archetype_registry_) {
+                    if (!(... && archetype->template contains<std::decay_t<Query>>())) {
+                        continue;
+                    }
+                    for (auto& mb : archetype->mem_blocks()) {
+                        auto pointers = std::make_tuple(component_fetch::fetch_pointer<Query>(mb, 0)...);
+                        for (std::size_t row = 0; row < mb.size(); ++row) {
+                            const bool matched = !mb.dead(row)
+                                && std::apply([&](auto&... ptrs) -> bool { return pred(*ptrs...); }, pointers);
+                            std::apply([](auto&... ptrs) { (ptrs++, ...); }, pointers);
+                            if (!matched) {
+                                continue;
+                            }
+                            const auto e = *mb.template const_ptr<entity>(row);
+                            mb.kill(row);
+                            for (auto& pool : pools_.values()) {
+                                pool->remove(e.id());
+                            }
+                            entity_pool_.retire(e);
+                            destroyed++;
+                        }
+                    }
+                }
+                if (destroyed != 0) {
+                    compact();
+                }
+                return destroyed;
+            }
+
+            [[nodiscard]] bool alive(entity e) const noexcept {
                 return entity_pool_.alive(e);
             }
 
+            /// @brief Index mapping component types to the dense IDs used by this registry
+            [[nodiscard]] const component_index& components() const noexcept {
+                return archetype_registry_.components();
+            }
+
+            /// @brief Make the current state durable. On a registry built on a mapped_file_storage,
+            /// rows destroyed with destroy_deferred() are compacted and the entity pool, the entity
+            /// records and the chunk directory are committed to the file with the chunks changed
+            /// since the previous checkpoint, see mapped_file_storage::commit. A chunk counts as
+            /// changed once a column of it is stamped with a newer version, so writes through a
+            /// reference or view obtained before the previous checkpoint are only saved with
+            /// other changes to their chunk. Otherwise chunk buffers are flushed to the backing
+            /// storage, no-op for the default heap storage.
+            /// @throws std::logic_error if an archetype has a component that is not trivially copyable
+            void checkpoint() {
+#ifdef ECS_HAS_MMAP
+                if (file_ != nullptr) {
+                    compact();
+                    const auto directory = save_directory();
+                    std::vector<std::uint64_t> dirty;
+                    for (const auto& [components, archetype] : archetype_registry_) {
+                        for (const auto& mb : archetype->mem_blocks()) {
+                            const auto offset = file_->offset_of(mb.data());
+                            if (mb.version() > committed_version_ || !std::ranges::binary_search(committed_blocks_, offset)) {
+                                dirty.push_back(offset);
+                            }
+                        }
+                    }
+                    file_->commit(directory, dirty);
+                    mark_committed();
+                    return;
+                }
+#endif
+                archetype_registry_.storage().sync();
+            }
+
+            /// @brief Age all chunks by one frame and compress the ones that have not been accessed
+            /// for the given number of frames. Compressed chunks are decompressed transparently when
+            /// a view or get touches them. Call once per frame.
+            /// @param frames number of frames without access after which a chunk is compressed
+            /// @return number of chunks compressed by this call
+            std::size_t compress_cold_chunks(std::size_t frames) {
+                std::size_t compressed = 0;
+                for (auto& [components, archetype] : archetype_registry_) {
+                    for (auto& mb : archetype->mem_blocks()) {
+                        if (mb.age() >= frames && !mb.compressed() && mb.compress()) {
+                            compressed++;
+                        }
+                    }
+                }
+                return compressed;
+            }
+
             /// @brief Get reference to component C
             /// @tparam C Component C
             /// @param ent Entity to read component from
             /// @return C& Reference to component C
             template<component C>
-            [[nodiscard]] C& get(entity ent) {
-                return std::get<0>(get_impl<C&>(*this, ent));
+            [[nodiscard]] component_reference_t<C&> get(entity ent) {
+                if constexpr (sparse_component<C>) {
+                    ensure_alive(ent);
+                    return pool<C>().get(ent.id());
+                } else {
+                    return std::get<0>(get_impl<C&>(*this, ent));
+                }
             }
 
             /// @brief Get const reference to component C
@@ -81,8 +433,13 @@ namespace ecs {
             /// @param ent Entity to read component from
             /// @return const C& Const reference to component C
             template<component C>
-            [[nodiscard]] const C& get(entity ent) const {
-                return std::get<0>(get_impl<const C&>(*this, ent));
+            [[nodiscard]] component_reference_t<const C&> get(entity ent) const {
+                if constexpr (sparse_component<C>) {
+                    ensure_alive(ent);
+                    return pool<C>().get(ent.id());
+                } else {
+                    return std::get<0>(get_impl<const C&>(*this, ent));
+                }
             }
 
             /// @brief Get components for a single entity
@@ -90,7 +447,7 @@ namespace ecs {
             /// @param ent Entity to query
             /// @return value_type Components tuple
             template<component_reference... Args>
-            [[nodiscard]] std::tuple<Args...> get(entity ent)
+            [[nodiscard]] std::tuple<component_reference_t<Args>...> get(entity ent)
                 requires(const_component_references_v<Args...>) {
                 return get_impl<Args...>(*this, ent);
             }
@@ -100,7 +457,7 @@ namespace ecs {
             /// @param ent Entity to query
             /// @return value_type Components tuple
             template<component_reference... Args>
-            [[nodiscard]] std::tuple<Args...> get(entity ent) const
+            [[nodiscard]] std::tuple<component_reference_t<Args>...> get(entity ent) const
                 requires(!const_component_references_v<Args...>) {
                 return get_impl<Args...>(*this, ent);
             }
@@ -113,8 +470,99 @@ namespace ecs {
             [[nodiscard]] bool has(entity e) const {
                 ensure_alive(e);
                 auto e_id = e.id();
-                const auto& loc = get_location(e_id);
-                return loc.archetype->template contains<C>();
+                if constexpr (sparse_component<C>) {
+                    return pools_.contains(archetype_registry_.components().find<C>()) && pool<C>().contains(e_id);
+                } else {
+                    const auto& loc = get_location(e_id);
+                    return loc.archetype->template contains<C>();
+                }
+            }
+
+            /// @brief Add a sparse component to an entity. The entity keeps its archetype.
+            /// @tparam C sparse component type
+            /// @param e entity
+            /// @param args arguments to construct the component from
+            /// @return C& reference to the new component
+            template<sparse_component C, typename... CArgs>
+            C& emplace(entity e, CArgs&&... args) {
+                ensure_alive(e);
+                return pool<C>().emplace(e.id(), std::forward<CArgs>(args)...);
+            }
+
+            /// @brief Remove a sparse component from an entity, no-op if it does not have one
+            /// @tparam C sparse component type
+            /// @param e entity
+            template<sparse_component C>
+            void remove(entity e) {
+                ensure_alive(e);
+                pool<C>().remove(e.id());
+            }
+
+            /// @brief Add and remove archetype components in a single structural change. The final
+            /// archetype is computed up front and the entity is moved once: kept components are
+            /// moved, added ones constructed in place and removed ones destroyed. Removing a component
+            /// the entity does not have is a no-op, adding one it already has throws std::logic_error.
+            /// reg.modify<ecs::add<moving, path>, ecs::remove<idle>>(e, moving{...}, path{...});
+            /// The add and remove lists may come in either order and either may be omitted.
+            /// @tparam Add ecs::add of the added component types
+            /// @tparam Remove ecs::remove of the removed component types
+            /// @param e entity
+            /// @param args added components, in the order of Add
+            template<typename Add, typename Remove = ecs::remove<>, typename... Args>
+            void modify(entity e, Args&&... args) {
+                modify_impl(e, Add{}, Remove{}, std::forward<Args>(args)...);
+            }
+
+            /// @brief Get or create the owning group of the given sparse components. The group owns
+            /// their pools: entities having all of them are kept packed at the front of each pool in
+            /// the same order, so iterating the group needs no lookups. A pool can be owned by one
+            /// group only, std::logic_error is thrown otherwise.
+            /// @tparam Owned sparse component types
+            /// @return ecs::group<Owned...>
+            template<sparse_component... Owned>
+            ecs::group<Owned...> group() {
+                static_assert(sizeof...(Owned) > 0, "Group must own at least one component");
+                [[maybe_unused]] unique_types<Owned...> uniqueness;
+
+                auto& handler = groups_[group_id::value<ecs::group<Owned...>>];
+                if (!handler) {
+                    handler = std::make_unique<basic_group>(std::vector<sparse_pool_base*>{ &pool<Owned>()... });
+                }
+                return ecs::group<Owned...>{ *handler, pool<Owned>()... };
+            }
+
+            /// @brief Enable or disable component C of an entity. The entity stays in its archetype,
+            /// views skip it while any of their components is disabled. A change stamps the column of
+            /// C as changed, since it changes which rows views of C visit.
+            /// @tparam C enableable component type
+            /// @param e entity
+            /// @param value true to enable
+            template<enableable_component C>
+            void enable(entity e, bool value = true) {
+                auto flag = get<enabled_flag<C>>(e);
+                if (flag.value() == value) {
+                    return;
+                }
+                flag = value;
+                const auto& location = get_location(e.id());
+                location.archetype->mem_blocks()[location.mem_block_index].mark_changed(components().find<C>(), version());
+            }
+
+            /// @brief Disable component C of an entity
+            /// @tparam C enableable component type
+            /// @param e entity
+            template<enableable_component C>
+            void disable(entity e) {
+                enable<C>(e, false);
+            }
+
+            /// @brief Check if component C of an entity is enabled
+            /// @tparam C enableable component type
+            /// @param e entity
+            /// @return boolean
+            template<enableable_component C>
+            [[nodiscard]] bool enabled(entity e) const {
+                return get<enabled_flag<C>>(e).value();
             }
 
             template<component_reference... Args>
@@ -132,15 +580,67 @@ namespace ecs {
         private:
 
             template<component_reference... Args>
-            static std::tuple<Args...> get_impl(auto&& self, entity e) {
+            static std::tuple<component_reference_t<Args>...> get_impl(auto&& self, entity e) {
+                static_assert(!(sparse_component<std::decay_t<Args>> || ...), "Sparse components are read one at a time with get");
                 self.ensure_alive(e);
                 auto& loc = self.get_location(e.id());
                 auto* archetype = loc.archetype;
-                return std::tuple<Args...>(std::ref(archetype->template get<Args>(loc))...);
+                return std::tuple<component_reference_t<Args>...>(archetype->template get<Args>(loc)...);
+            }
+
+            template<component... Removed, typename... Args>
+            void modify_impl(entity e, ecs::remove<Removed...> removed, ecs::remove<>, Args&&... args) {
+                modify_impl(e, add<>{}, removed, std::forward<Args>(args)...);
+            }
+
+            template<component... Removed, component... Added, typename... Args>
+            void modify_impl(entity e, ecs::remove<Removed...> removed, add<Added...> added, Args&&... args) {
+                modify_impl(e, added, removed, std::forward<Args>(args)...);
+            }
+
+            template<component... Added, component... Removed, typename... Args>
+            void modify_impl(entity e, add<Added...> added, ecs::remove<Removed...> removed, Args&&... args) {
+                static_assert((std::is_same_v<std::decay_t<Args>, Added> && ...), "Expected one argument per added component");
+                static_assert(!(sparse_component<Added> || ...) && !(sparse_component<Removed> || ...),
+                    "Sparse components are added with emplace and removed with remove");
+                [[maybe_unused]] unique_types<Added...> uniqueness;
+
+                ensure_alive(e);
+                auto location = get_location(e.id());
+                auto* source = location.archetype;
+                if ((source->template contains<Added>() || ...)) {
+                    throw std::logic_error{"Entity already has this component"};
+                }
+
+                auto* target = archetype_registry_.ensure_archetype(*source, added, removed);
+                if (target == source) {
+                    return;
+                }
+                source->ensure_resident(location);
+                auto target_location = target->emplace_back_from(*source, location, std::forward<Args>(args)...);
+                auto moved = source->erase_and_fill(location);
+                if (moved) {
+                    save_location(moved->id(), location);
+                }
+                save_location(e.id(), target_location);
+            }
+
+            template<sparse_component C>
+            sparse_pool<C>& pool() {
+                auto& pool = pools_[archetype_registry_.components().id<C>()];
+                if (!pool) {
+                    pool = std::make_unique<sparse_pool<C>>();
+                }
+                return static_cast<sparse_pool<C>&>(*pool);
+            }
+
+            template<sparse_component C>
+            const sparse_pool<C>& pool() const {
+                return static_cast<const sparse_pool<C>&>(*pools_.at(archetype_registry_.components().find<C>()));
             }
 
             inline void ensure_alive(const entity& e) const {
-                if(!const_cast<registry*>(this)->alive(e)) {
+                if(!alive(e)) {
                     throw std::logic_error{"Entity not found"};
                 }
             }
@@ -169,12 +669,264 @@ namespace ecs {
                 return archetype_registry_;
             }
 
+#ifdef ECS_HAS_MMAP
+            /// @brief Entity record of a checkpoint, the location with the archetype as its position
+            /// in the directory
+            struct saved_location {
+                std::uint32_t id;
+                std::uint32_t archetype;
+                std::uint32_t mem_block_index;
+                std::uint32_t entry_index;
+            };
+
+            /// @brief Bounds checked reader over a checkpoint directory
+            class directory_reader {
+                public:
+                    explicit directory_reader(std::span<const std::byte> bytes) noexcept : bytes_(bytes) {}
+
+                    template<typename T>
+                    T take() {
+                        T value{};
+                        std::memcpy(&value, bytes(sizeof(T)).data(), sizeof(T));
+                        return value;
+                    }
+
+                    /// @brief Take an element count, checked against the remaining bytes
+                    std::size_t count(std::size_t element_size) {
+                        const auto n = take<std::uint64_t>();
+                        if (n > (bytes_.size() - position_) / element_size) {
+                            throw std::runtime_error{"Storage file directory is corrupt"};
+                        }
+                        return static_cast<std::size_t>(n);
+                    }
+
+                    std::span<const std::byte> bytes(std::size_t n) {
+                        if (n > bytes_.size() - position_) {
+                            throw std::runtime_error{"Storage file directory is corrupt"};
+                        }
+                        position_ += n;
+                        return bytes_.subspan(position_ - n, n);
+                    }
+
+                private:
+                    std::span<const std::byte> bytes_;
+                    std::size_t position_{};
+            };
+
+            /// @brief Serialize the entity pool, the archetypes with their column layout and chunks,
+            /// and the entity records. Chunks are referenced by file offset and entities by
+            /// archetype position, so the directory stays valid wherever the file is mapped:
+            /// |generations|freed IDs|archetype count|columns, max size, chunks of each archetype|entity records|
+            std::vector<std::byte> save_directory() const {
+                std::vector<std::byte> out;
+                auto put = [&out](const auto& value) {
+                    const auto* bytes = reinterpret_cast<const std::byte*>(&value);
+                    out.insert(out.end(), bytes, bytes + sizeof(value));
+                };
+                auto put_all = [&](const auto& values) {
+                    put(std::uint64_t{ values.size() });
+                    for (const auto& value : values) {
+                        put(value);
+                    }
+                };
+                put_all(entity_pool_.generations());
+                put_all(entity_pool_.freed());
+
+                std::vector<std::pair<const archetype*, std::uint32_t>> ordinals;
+                put(std::uint64_t{ archetype_registry_.size() });
+                for (const auto& [components, archetype] : archetype_registry_) {
+                    const auto& layout = archetype->mem_blocks().front().layout();
+                    put(std::uint64_t{ layout.size() });
+                    for (const auto& block : layout.values()) {
+                        if (!block.meta.type->trivially_copyable) {
+                            throw std::logic_error{"Component \"" + std::string{block.meta.type->name} + "\" cannot be persisted"};
+                        }
+                        put(std::uint64_t{ block.meta.type->name.size() });
+                        const auto* name = reinterpret_cast<const std::byte*>(block.meta.type->name.data());
+                        out.insert(out.end(), name, name + block.meta.type->name.size());
+                        put(std::uint64_t{ block.offset });
+                        put(std::uint64_t{ block.meta.type->size });
+                    }
+                    put(std::uint64_t{ archetype->max_size() });
+                    put(std::uint64_t{ archetype->mem_blocks().size() });
+                    for (const auto& mb : archetype->mem_blocks()) {
+                        put(file_->offset_of(mb.data()));
+                        put(std::uint64_t{ mb.size() });
+                    }
+                    ordinals.emplace_back(archetype.get(), static_cast<std::uint32_t>(ordinals.size()));
+                }
+                std::ranges::sort(ordinals);
+
+                put(std::uint64_t{ entity_map_.size() });
+                for (const auto& [id, location] : entity_map_) {
+                    const auto ordinal = std::ranges::lower_bound(ordinals, location.archetype, {}, [](const auto& o) { return o.first; })->second;
+                    put(saved_location{ id, ordinal, static_cast<std::uint32_t>(location.mem_block_index),
+                        static_cast<std::uint32_t>(location.entry_index) });
+                }
+                return out;
+            }
+
+            /// @brief Restore the last checkpoint of the storage file, see save_directory. The chunk
+            /// directory is checked against the catalog and the file, and every entity record
+            /// against the entity stored in its row. Blocks not referenced by the checkpoint are
+            /// returned to the free list.
+            void restore(const component_catalog& catalog) {
+                struct saved_archetype {
+                    std::vector<std::string_view> names;
+                    std::vector<std::pair<std::uint64_t, std::uint64_t>> columns;
+                    std::uint64_t max_size;
+                    std::vector<std::pair<std::uint64_t, std::uint64_t>> chunks;
+                };
+                auto corrupt = [] { return std::runtime_error{"Storage file directory is corrupt"}; };
+
+                directory_reader in{file_->directory()};
+                if (file_->directory().empty()) {
+                    file_->recover({});
+                    return;
+                }
+                std::vector<generation_id_t> generations(in.count(sizeof(generation_id_t)));
+                for (auto& generation : generations) {
+                    generation = in.take<generation_id_t>();
+                }
+                std::vector<entity_id_t> freed(in.count(sizeof(entity_id_t)));
+                for (auto& id : freed) {
+                    id = in.take<entity_id_t>();
+                    if (id >= generations.size()) {
+                        throw corrupt();
+                    }
+                }
+
+                std::vector<saved_archetype> saved(in.count(4 * sizeof(std::uint64_t)));
+                std::vector<std::uint64_t> live;
+                for (auto& a : saved) {
+                    const auto columns = in.count(3 * sizeof(std::uint64_t));
+                    for (std::size_t c = 0; c < columns; ++c) {
+                        const auto name = in.bytes(in.count(1));
+                        a.names.emplace_back(reinterpret_cast<const char*>(name.data()), name.size());
+                        const auto offset = in.take<std::uint64_t>();
+                        a.columns.emplace_back(offset, in.take<std::uint64_t>());
+                    }
+                    a.max_size = in.take<std::uint64_t>();
+                    a.chunks.resize(in.count(2 * sizeof(std::uint64_t)));
+                    for (auto& [offset, rows] : a.chunks) {
+                        offset = in.take<std::uint64_t>();
+                        rows = in.take<std::uint64_t>();
+                        live.push_back(offset);
+                    }
+                }
+                std::vector<saved_location> records(in.count(sizeof(saved_location)));
+                for (auto& record : records) {
+                    record = in.take<saved_location>();
+                }
+                // every block the checkpoint does not reference is free, allocating is safe from here on
+                file_->recover(std::move(live));
+
+                try {
+                    std::vector<archetype*> archetypes;
+                    std::size_t rows_total = 0;
+                    for (const auto& a : saved) {
+                        component_meta_set components;
+                        for (const auto name : a.names) {
+                            // the entity and enable flag columns come with the archetype and their component
+                            catalog.insert_type(name, components, archetype_registry_.components());
+                        }
+                        auto* archetype = archetype_registry_.ensure_archetype(std::move(components));
+                        check_layout(*archetype, a.names, a.columns, a.max_size);
+                        std::vector<std::pair<std::byte*, std::size_t>> chunks;
+                        for (std::size_t c = 0; c < a.chunks.size(); ++c) {
+                            const auto [offset, rows] = a.chunks[c];
+                            // destroying the last row of a chunk before the last one leaves it partly filled
+                            if (rows > a.max_size) {
+                                throw corrupt();
+                            }
+                            chunks.emplace_back(file_->at(offset), static_cast<std::size_t>(rows));
+                            rows_total += rows;
+                        }
+                        archetype->restore(chunks);
+                        archetypes.push_back(archetype);
+                    }
+
+                    std::vector<bool> seen(generations.size());
+                    for (const auto& record : records) {
+                        if (record.archetype >= archetypes.size() || record.id >= generations.size() || seen[record.id]) {
+                            throw corrupt();
+                        }
+                        auto* archetype = archetypes[record.archetype];
+                        const auto& chunks = archetype->mem_blocks();
+                        if (record.mem_block_index >= chunks.size() || record.entry_index >= chunks[record.mem_block_index].size()
+                            || *chunks[record.mem_block_index].template const_ptr<entity>(record.entry_index) != entity{ record.id, generations[record.id] }) {
+                            throw std::runtime_error{"Storage file does not match its last checkpoint"};
+                        }
+                        seen[record.id] = true;
+                        save_location(record.id, { archetype, record.mem_block_index, record.entry_index });
+                    }
+                    if (records.size() != rows_total || records.size() + freed.size() != generations.size()) {
+                        throw std::runtime_error{"Storage file does not match its last checkpoint"};
+                    }
+                    entity_pool_.restore(std::move(generations), std::move(freed));
+                } catch (...) {
+                    // the chunks stay in the file for the next attempt
+                    detach_chunks();
+                    throw;
+                }
+            }
+
+            /// @brief Check that a restored archetype has the column layout of the checkpoint
+            void check_layout(const archetype& restored, const std::vector<std::string_view>& names,
+                const std::vector<std::pair<std::uint64_t, std::uint64_t>>& columns, std::uint64_t max_size) const {
+                const auto& layout = restored.mem_blocks().front().layout();
+                bool matches = restored.mem_blocks().size() == 1 && restored.mem_blocks().front().empty()
+                    && restored.block_size() == file_->block_size() && restored.max_size() == max_size
+                    && layout.size() == names.size();
+                std::size_t c = 0;
+                for (const auto& block : layout.values()) {
+                    matches = matches && block.meta.type->name == names[c] && block.offset == columns[c].first
+                        && block.meta.type->size == columns[c].second;
+                    c++;
+                }
+                if (!matches) {
+                    throw std::runtime_error{"Archetype of the storage file does not match the component catalog"};
+                }
+            }
+
+            /// @brief Remember the chunks in the file as of the last checkpoint and start a new
+            /// version, chunks stamped after it are written by the next checkpoint
+            void mark_committed() {
+                committed_blocks_.clear();
+                for (const auto& [components, archetype] : archetype_registry_) {
+                    for (const auto& mb : archetype->mem_blocks()) {
+                        committed_blocks_.push_back(file_->offset_of(mb.data()));
+                    }
+                }
+                std::ranges::sort(committed_blocks_);
+                committed_version_ = version();
+                advance_version();
+            }
+
+            /// @brief Leave all chunks in the storage file instead of freeing them
+            void detach_chunks() noexcept {
+                for (auto& [components, archetype] : archetype_registry_) {
+                    archetype->detach();
+                }
+            }
+#endif
+
+            registry_config config_{};
             entity_pool entity_pool_;
+            std::unique_ptr<fixed_block_storage> arena_{};
             archetype_registry archetype_registry_;
             sparse_map<entity_id_t, entity_location> entity_map_;
+            sparse_map<component_id_t, std::unique_ptr<sparse_pool_base>> pools_;
+            sparse_map<std::uint32_t, std::unique_ptr<basic_group>> groups_;
+#ifdef ECS_HAS_MMAP
+            mapped_file_storage* file_{};
+            std::vector<std::uint64_t> committed_blocks_{};
+            std::uint64_t committed_version_{};
+#endif
 
             template<component_reference... Args>
             friend class view;
+            friend class replica_writer;
     };
 
     template<component_reference... Args>
@@ -183,8 +935,59 @@ namespace ecs {
             
             static constexpr bool is_const = const_component_references_v<Args...>;
 
+            static_assert(!(sparse_component<std::decay_t<Args>> || ...), "Sparse components are iterated with groups");
+
             using registry_type = std::conditional_t<is_const, const registry&, registry&>;
 
+            /// @brief Whether C is one of the view components
+            template<typename C>
+            static constexpr bool has_component = (... || std::is_same_v<C, std::decay_t<Args>>);
+
+            using mem_block_type = std::conditional_t<is_const, const mem_block, mem_block>;
+
+            /// @brief Part of a view returned by split(), the rows [first, last) of some of the
+            /// matched chunks. Parts do not overlap and can be processed on different threads.
+            class partition {
+                public:
+
+                    decltype(auto) each() const {
+                        return slices_ | std::views::transform(as_view) | std::views::join;
+                    }
+
+                    void each(auto&& func) const {
+                        for (const auto& s : slices_) {
+                            for (auto entry : as_view(s)) {
+                                std::apply(func, entry);
+                            }
+                        }
+                    }
+
+                    /// @brief Number of rows the part visits
+                    [[nodiscard]] std::size_t size() const noexcept {
+                        return size_;
+                    }
+
+                    [[nodiscard]] bool empty() const noexcept {
+                        return size_ == 0;
+                    }
+
+                private:
+
+                    friend class view;
+
+                    struct slice {
+                        mem_block_type* block;
+                        std::size_t first, last;
+                    };
+
+                    static mem_block_view<Args...> as_view(const slice& s) {
+                        return mem_block_view<Args...>(*s.block, s.first, s.last);
+                    }
+
+                    std::vector<slice> slices_{};
+                    std::size_t size_{};
+            };
+
             explicit view(registry_type registry) noexcept : registry_(registry) {}
 
             decltype(auto) each() requires (!is_const) {
@@ -216,15 +1019,253 @@ namespace ecs {
             const std::size_t size() const noexcept {
                 std::size_t c = 0;
                 for(const auto& mb : mem_blocks(registry_.get_archetype_registry())) {
-                    c += mb.size();
+                    c += mem_block_view<Args...>(mb).size();
                 }
                 return c;
             }
 
+            /// @brief Count matched entities whose flag component F is set, 64 entities at a time
+            /// @tparam F flag component type, must be one of the view components
+            /// @return std::size_t
+            template<flag_component F>
+            std::size_t count() const {
+                static_assert((... || std::is_same_v<F, std::decay_t<Args>>), "Flag must be part of the view");
+                std::size_t c = 0;
+                for(const auto& mb : mem_blocks(registry_.get_archetype_registry())) {
+                    c += mb.template count<F>();
+                }
+                return c;
+            }
+
+            /// @brief Join every matched row with the entity it references through Member, a pointer
+            /// to an entity field of one of the view components, and call
+            /// func(view components..., Targets...) for each row whose target is alive and has all
+            /// Targets components. Instead of a lookup per row, the targets referenced from a chunk are
+            /// collected, sorted by location and fetched in memory order, so rows are visited in the
+            /// order of their targets rather than their own.
+            ///
+            ///     reg.view<const chase&, position&>().join<&chase::target, const position&>(
+            ///         [](const chase&, position& pos, const position& target) { ... });
+            ///
+            /// @tparam Member pointer to the entity field
+            /// @tparam Targets component references fetched from the target entity
+            /// @param func callback
+            template<auto Member, component_reference... Targets>
+            void join(auto&& func) requires(!is_const) {
+                join_impl<Member, Targets...>(registry_, func);
+            }
+
+            template<auto Member, component_reference... Targets>
+            void join(auto&& func) const requires(is_const && const_component_references_v<Targets...>) {
+                join_impl<Member, Targets...>(registry_, func);
+            }
+
+            /// @brief Divide the matched rows into n parts whose sizes differ by at most one row, for
+            /// a task system to process in parallel. Chunks are cut where a part is full, so one large
+            /// archetype spreads over all parts. The parts refer to the chunks and are invalidated by
+            /// any structural change to the registry.
+            ///
+            ///     for (auto& part : reg.view<position&, const velocity&>().split(workers)) {
+            ///         pool.submit([&part] { part.each(integrate); });
+            ///     }
+            ///
+            /// Compressed chunks are decompressed and written columns are marked as changed here, so
+            /// that iterating the parts concurrently only touches component data.
+            /// @param n number of parts, parts are empty if the view has fewer than n rows
+            /// @throws std::invalid_argument if n is 0
+            /// @return std::vector<partition> the parts, in iteration order
+            std::vector<partition> split(std::size_t n) requires (!is_const) {
+                return split_impl(registry_.get_archetype_registry(), n);
+            }
+
+            std::vector<partition> split(std::size_t n) const requires (is_const) {
+                return split_impl(registry_.get_archetype_registry(), n);
+            }
+
+            /// @brief Range over the matched chunks for chunk-wise processing, e.g. over
+            /// mem_block::bit_words of flag components
+            decltype(auto) chunks() requires (!is_const) {
+                auto& archetype_registry = registry_.get_archetype_registry();
+                auto written = [&archetype_registry](mem_block& mb) -> mem_block& {
+                    mark_written(mb, archetype_registry);
+                    return mb;
+                };
+                return mem_blocks(archetype_registry) | std::views::transform(written);
+            }
+
+            decltype(auto) chunks() const requires (is_const) {
+                return mem_blocks(registry_.get_archetype_registry());
+            }
+
+            /// @brief Check whether a Watched column changed after version since in any archetype the
+            /// view matches. Costs a lookup per archetype and watched component, entities and
+            /// chunks are not visited.
+            /// @tparam Watched component types, a subset of the view components
+            /// @param since change version, see registry::version
+            template<component... Watched>
+            [[nodiscard]] bool changed(std::uint64_t since) const {
+                static_assert((... && has_component<Watched>), "Watched components must be part of the view");
+                for (const auto& [components, archetype] : registry_.get_archetype_registry()) {
+                    if ((... && archetype->template contains<std::decay_t<Args>>())
+                        && (... || (archetype->template version<Watched>() > since))) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /// @brief Call func for every matched row of the chunks in which a Watched column changed
+            /// after version since, other chunks are skipped as a whole
+            /// @tparam Watched component types, a subset of the view components
+            /// @param since change version, see registry::version
+            /// @param func callback, called with the view components
+            template<component... Watched>
+            void each_changed(std::uint64_t since, auto&& func) requires (!is_const) {
+                each_changed_impl<Watched...>(registry_.get_archetype_registry(), since, func);
+            }
+
+            template<component... Watched>
+            void each_changed(std::uint64_t since, auto&& func) const requires (is_const) {
+                each_changed_impl<Watched...>(registry_.get_archetype_registry(), since, func);
+            }
+
         private:
 
+            static std::vector<partition> split_impl(auto&& archetype_registry, std::size_t n) {
+                if (n == 0) {
+                    throw std::invalid_argument{"A view cannot be split into 0 parts"};
+                }
+                std::vector<std::pair<mem_block_type*, std::size_t>> blocks;
+                std::size_t total = 0;
+                for (mem_block_type& mb : mem_blocks(archetype_registry)) {
+                    if constexpr (!is_const) {
+                        mark_written(mb, archetype_registry);
+                    }
+                    static_cast<void>(mb.data());
+                    const auto rows = mem_block_view<Args...>(mb).size();
+                    if (rows != 0) {
+                        blocks.emplace_back(&mb, rows);
+                        total += rows;
+                    }
+                }
+
+                // the first total % n parts take one row more
+                auto quota = [total, n](std::size_t part) {
+                    return total / n + (part < total % n ? 1 : 0);
+                };
+                std::vector<partition> parts(n);
+                std::size_t part = 0;
+                for (auto [mb, rows] : blocks) {
+                    std::size_t first = 0;
+                    while (rows != 0) {
+                        while (parts[part].size_ == quota(part)) {
+                            part++;
+                        }
+                        const auto take = std::min(rows, quota(part) - parts[part].size_);
+                        const auto last = take == rows ? mb->size() : mem_block_view<Args...>(*mb, first, mb->size()).nth_row(take);
+                        parts[part].slices_.push_back({ mb, first, last });
+                        parts[part].size_ += take;
+                        rows -= take;
+                        first = last;
+                    }
+                }
+                return parts;
+            }
+
+            template<component... Watched>
+            static void each_changed_impl(auto&& archetype_registry, std::uint64_t since, auto&& func) {
+                static_assert((... && has_component<Watched>), "Watched components must be part of the view");
+                const auto& index = archetype_registry.components();
+                for (auto& mb : mem_blocks(archetype_registry)) {
+                    if (!(... || (mb.version(index.template find<Watched>()) > since))) {
+                        continue;
+                    }
+                    if constexpr (!is_const) {
+                        mark_written(mb, archetype_registry);
+                    }
+                    for (auto entry : mem_block_view<Args...>(mb)) {
+                        std::apply(func, entry);
+                    }
+                }
+            }
+
+            /// @brief Stamp the columns the view hands out mutable references to as changed
+            static void mark_written(mem_block& mb, const archetype_registry& archetype_registry) noexcept {
+                const auto version = archetype_registry.version();
+                const auto& index = archetype_registry.components();
+                auto mark = [&]<typename C>() {
+                    if constexpr (!std::is_const_v<std::remove_reference_t<C>>) {
+                        mb.mark_changed(index.template find<std::decay_t<C>>(), version);
+                    }
+                };
+                (..., mark.template operator()<Args>());
+            }
+
+            template<auto Member, component_reference... Targets>
+            static void join_impl(auto& registry, auto&& func) {
+                using member_traits = detail::member_pointer_traits<decltype(Member)>;
+                constexpr std::size_t source_index = []() {
+                    constexpr std::array<bool, sizeof...(Args)> matches{ std::is_same_v<std::decay_t<Args>, typename member_traits::class_type>... };
+                    return static_cast<std::size_t>(std::ranges::find(matches, true) - matches.begin());
+                }();
+                static_assert(source_index < sizeof...(Args), "Member must belong to a view component");
+                static_assert(std::is_same_v<typename member_traits::field_type, entity>, "Member must be an entity field");
+                static_assert(!(sparse_component<std::decay_t<Targets>> || ...), "Join targets must be archetype components");
+
+                using source_iterator = decltype(std::declval<mem_block_view<Args...>&>().begin());
+                struct match {
+                    source_iterator source;
+                    entity_location target;
+                };
+                std::vector<match> matches;
+                for (auto mem_block_view : mem_blocks_views(registry.get_archetype_registry())) {
+                    matches.clear();
+                    for (auto iter = mem_block_view.begin(); iter != mem_block_view.end(); ++iter) {
+                        const entity target = std::get<source_index>(*iter).*Member;
+                        if (!registry.entity_pool_.alive(target)) {
+                            continue;
+                        }
+                        const auto& location = registry.get_location(target.id());
+                        if ((location.archetype->template contains<std::decay_t<Targets>>() && ...)) {
+                            matches.push_back({ iter, location });
+                        }
+                    }
+                    std::ranges::sort(matches, {}, [](const match& m) {
+                        return std::tuple{ m.target.archetype, m.target.mem_block_index, m.target.entry_index };
+                    });
+
+                    // component pointers to row 0 of the current target chunk, advanced per match
+                    const mem_block* target_block = nullptr;
+                    std::tuple<decltype(component_fetch::fetch_pointer<Targets>(std::declval<mem_block&>(), 0))...> targets{};
+                    for (const auto& m : matches) {
+                        auto& block = m.target.archetype->mem_blocks()[m.target.mem_block_index];
+                        if (&block != target_block) {
+                            target_block = &block;
+                            targets = std::make_tuple(component_fetch::fetch_pointer<Targets>(block, 0)...);
+                            const auto version = registry.get_archetype_registry().version();
+                            auto mark = [&]<typename C>() {
+                                if constexpr (!std::is_const_v<std::remove_reference_t<C>>) {
+                                    block.mark_changed(registry.components().template find<std::decay_t<C>>(), version);
+                                }
+                            };
+                            (..., mark.template operator()<Targets>());
+                        }
+                        auto pointers = targets;
+                        std::apply([&](auto&... ptrs) { ((ptrs += m.target.entry_index), ...); }, pointers);
+                        std::apply([&](auto&&... ptrs) {
+                            std::apply([&](auto&&... sources) { func(sources..., *ptrs...); }, *m.source);
+                        }, pointers);
+                    }
+                }
+            }
+
             static decltype(auto) mem_blocks_views(auto&& archetype_registry) {
-                auto as_typed_mem_block = [](auto& mem_block) -> decltype(auto) { return mem_block_view<Args...>(mem_block); };
+                auto as_typed_mem_block = [&archetype_registry](auto& mem_block) -> decltype(auto) {
+                    if constexpr (!is_const) {
+                        mark_written(mem_block, archetype_registry);
+                    }
+                    return mem_block_view<Args...>(mem_block);
+                };
 
                 return mem_blocks(archetype_registry)
                     | std::views::transform(as_typed_mem_block); // transform into mem_block view
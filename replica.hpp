@@ -0,0 +1,309 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "registry.hpp"
+#include "storage.hpp"
+
+#ifdef ECS_HAS_MMAP
+
+namespace ecs {
+
+    /// @brief Process independent key of a component type, the FNV-1a hash of its type name.
+    /// Writer and readers have to be built with the same compiler for the names to match.
+    ///
+    /// @param name Type name, see meta_t::name
+    /// @return std::uint64_t Type key
+    constexpr std::uint64_t replica_type_key(std::string_view name) noexcept {
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const char c : name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    /// @brief Records of the chunk directory in shared memory. All offsets are relative to the start
+    /// of the shared memory object. The directory is:
+    /// |archetype count|archetype 0|columns of 0|chunks of 0|archetype 1|...
+    namespace replica_format {
+
+        struct archetype_record {
+            std::uint64_t columns;
+            std::uint64_t chunks;
+        };
+
+        struct column_record {
+            std::uint64_t type;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        struct chunk_record {
+            std::uint64_t block;
+            std::uint64_t rows;
+            /// @brief Size of the chunk buffer, smaller than a storage block for small chunks
+            std::uint64_t size;
+        };
+
+    }
+
+    /// @brief Publishes the chunk directory of a registry whose chunks live in a
+    /// shared_memory_storage. Component data is not copied: readers map the chunks themselves. Wrap
+    /// every change to the world in begin_update() and publish(), readers retry while an update is
+    /// in progress:
+    ///
+    ///     writer.begin_update();
+    ///     run_systems(reg);
+    ///     writer.publish(reg);
+    ///
+    /// Rows destroyed with registry::destroy_deferred stay visible until compact(), disabled
+    /// components are not masked.
+    class replica_writer {
+
+        public:
+
+            /// @brief Construct a writer
+            /// @param storage storage the chunks of the published registry come from
+            explicit replica_writer(shared_memory_storage& storage) noexcept : storage_(&storage) {}
+
+            /// @brief Mark the world as being changed, readers retry until publish()
+            void begin_update() noexcept {
+                auto sequence = std::atomic_ref{ storage_->sequence() };
+                if (sequence.load(std::memory_order_relaxed) % 2 == 0) {
+                    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_release);
+                }
+            }
+
+            /// @brief Rewrite the chunk directory and end the update started by begin_update()
+            /// @param reg registry, built on the storage of this writer
+            /// @throws std::logic_error if a chunk is not in the shared memory object
+            /// @throws std::length_error if the directory does not fit, the update is ended first
+            void publish(const registry& reg) {
+                begin_update();
+                scratch_.clear();
+                std::uint64_t archetypes = 0;
+                append(archetypes);
+                for (const auto& [components, archetype] : reg.get_archetype_registry()) {
+                    const auto& chunks = archetype->mem_blocks();
+                    const auto& layout = chunks.front().layout();
+                    append(replica_format::archetype_record{ layout.size(), chunks.size() });
+                    for (const auto& block : layout.values()) {
+                        append(replica_format::column_record{ replica_type_key(block.meta.type->name), block.offset, block.meta.type->size });
+                    }
+                    for (const auto& chunk : chunks) {
+                        const auto* data = chunk.data();
+                        if (!storage_->contains(data)) {
+                            end_update();
+                            throw std::logic_error{"Chunk is not in shared memory"};
+                        }
+                        append(replica_format::chunk_record{ storage_->offset_of(data), chunk.size(), chunk.block_size() });
+                    }
+                    archetypes++;
+                }
+                std::memcpy(scratch_.data(), &archetypes, sizeof(archetypes));
+
+                if (scratch_.size() > storage_->directory_capacity()) {
+                    end_update();
+                    throw std::length_error{"Replica directory is too small"};
+                }
+                std::memcpy(storage_->directory(), scratch_.data(), scratch_.size());
+                end_update();
+            }
+
+        private:
+
+            void end_update() noexcept {
+                auto sequence = std::atomic_ref{ storage_->sequence() };
+                if (sequence.load(std::memory_order_relaxed) % 2 == 1) {
+                    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                }
+            }
+
+            void append(const auto& record) {
+                const auto* bytes = reinterpret_cast<const std::byte*>(&record);
+                scratch_.insert(scratch_.end(), bytes, bytes + sizeof(record));
+            }
+
+            shared_memory_storage* storage_;
+            std::vector<std::byte> scratch_{};
+    };
+
+    /// @brief Read-only replica of a world published by a replica_writer, possibly in another
+    /// process. Reads are zero copy and lock free: read() runs the visitor and repeats it if the
+    /// writer changed the world meanwhile, so a visitor that returns normally has seen a consistent
+    /// snapshot. Only plain trivially copyable components can be read.
+    class replica_reader {
+
+        public:
+
+            /// @brief Map a shared memory object read-only
+            /// @param name object name passed to shared_memory_storage
+            explicit replica_reader(const std::string& name) {
+                fd_ = ::shm_open(name.c_str(), O_RDONLY, 0);
+                if (fd_ < 0) {
+                    throw std::runtime_error{"Cannot open shared memory object " + name};
+                }
+                struct stat st{};
+                ::fstat(fd_, &st);
+                size_ = static_cast<std::size_t>(st.st_size);
+                void* base = size_ >= sizeof(shared_memory_storage::header)
+                    ? ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0) : MAP_FAILED;
+                if (base == MAP_FAILED) {
+                    ::close(fd_);
+                    throw std::runtime_error{"Cannot map shared memory object " + name};
+                }
+                base_ = static_cast<const std::byte*>(base);
+
+                const auto* h = get_header();
+                if (h->magic != shared_memory_storage::shm_magic || h->version != shared_memory_storage::shm_version
+                    || h->data_offset + h->capacity * h->block_size > size_) {
+                    ::munmap(const_cast<std::byte*>(base_), size_);
+                    ::close(fd_);
+                    throw std::runtime_error{"Shared memory object " + name + " is not compatible"};
+                }
+            }
+
+            replica_reader(const replica_reader&) = delete;
+            replica_reader& operator=(const replica_reader&) = delete;
+
+            ~replica_reader() {
+                ::munmap(const_cast<std::byte*>(base_), size_);
+                ::close(fd_);
+            }
+
+            /// @brief Run visit(*this) until it has seen a consistent snapshot. An attempt that
+            /// overlapped an update is discarded and visit runs again, so it should start by
+            /// resetting whatever it accumulates.
+            /// @param visit callable, typically calling each()
+            /// @return std::uint64_t sequence number of the snapshot
+            std::uint64_t read(auto&& visit) const {
+                for (;;) {
+                    const auto sequence = begin_read();
+                    visit(*this);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (load_sequence(std::memory_order_relaxed) == sequence) {
+                        return sequence;
+                    }
+                }
+            }
+
+            /// @brief Call func(const Ts&...) for every published row that has all Ts components.
+            /// Call inside read(), on its own the rows may be torn by a concurrent update.
+            /// @tparam Ts component types
+            /// @param func callback
+            template<typename... Ts>
+            void each(auto&& func) const {
+                static_assert((... && (std::is_trivially_copyable_v<Ts> && !flag_component<Ts> && !lane_component<Ts> && !split_component<Ts>)),
+                    "Only plain trivially copyable components can be read from a replica");
+                const std::array<std::uint64_t, sizeof...(Ts)> keys{ replica_type_key(type_name<Ts>())... };
+                const auto* h = get_header();
+                const auto* cursor = base_ + shared_memory_storage::directory_offset;
+                const auto* directory_end = cursor + h->directory_capacity;
+
+                // a torn directory may hold anything, stop at the first record out of bounds
+                std::uint64_t archetypes{};
+                if (!take(cursor, directory_end, archetypes)) {
+                    return;
+                }
+                for (std::uint64_t a = 0; a < archetypes; ++a) {
+                    replica_format::archetype_record archetype{};
+                    if (!take(cursor, directory_end, archetype)) {
+                        return;
+                    }
+                    std::array<std::uint64_t, sizeof...(Ts)> offsets{};
+                    std::size_t found = 0;
+                    for (std::uint64_t c = 0; c < archetype.columns; ++c) {
+                        replica_format::column_record column{};
+                        if (!take(cursor, directory_end, column)) {
+                            return;
+                        }
+                        for (std::size_t k = 0; k < keys.size(); ++k) {
+                            if (keys[k] == column.type) {
+                                offsets[k] = column.offset;
+                                found++;
+                            }
+                        }
+                    }
+                    for (std::uint64_t c = 0; c < archetype.chunks; ++c) {
+                        replica_format::chunk_record chunk{};
+                        if (!take(cursor, directory_end, chunk)) {
+                            return;
+                        }
+                        if (found != keys.size() || !valid_chunk<Ts...>(chunk, offsets)) {
+                            continue;
+                        }
+                        const auto* block = base_ + chunk.block;
+                        for (std::uint64_t row = 0; row < chunk.rows; ++row) {
+                            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                                func(*(reinterpret_cast<const Ts*>(block + offsets[I]) + row)...);
+                            }(std::index_sequence_for<Ts...>{});
+                        }
+                    }
+                }
+            }
+
+            /// @brief Sequence number of the last completed update, odd while one is in progress
+            [[nodiscard]] std::uint64_t sequence() const noexcept {
+                return load_sequence(std::memory_order_acquire);
+            }
+
+        private:
+
+            [[nodiscard]] const shared_memory_storage::header* get_header() const noexcept {
+                return reinterpret_cast<const shared_memory_storage::header*>(base_);
+            }
+
+            [[nodiscard]] std::uint64_t load_sequence(std::memory_order order) const noexcept {
+                // the mapping is read-only, an atomic load does not write
+                return std::atomic_ref{ const_cast<std::uint64_t&>(get_header()->sequence) }.load(order);
+            }
+
+            [[nodiscard]] std::uint64_t begin_read() const noexcept {
+                for (;;) {
+                    const auto sequence = load_sequence(std::memory_order_acquire);
+                    if (sequence % 2 == 0) {
+                        return sequence;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+
+            template<typename T>
+            static bool take(const std::byte*& cursor, const std::byte* end, T& record) noexcept {
+                if (static_cast<std::size_t>(end - cursor) < sizeof(T)) {
+                    return false;
+                }
+                std::memcpy(&record, cursor, sizeof(T));
+                cursor += sizeof(T);
+                return true;
+            }
+
+            template<typename... Ts>
+            [[nodiscard]] bool valid_chunk(const replica_format::chunk_record& chunk, const auto& offsets) const noexcept {
+                const auto* h = get_header();
+                if (chunk.block < h->data_offset || chunk.size > size_ || chunk.block > size_ - chunk.size) {
+                    return false;
+                }
+                std::size_t i = 0;
+                return (... && (chunk.rows <= chunk.size / sizeof(Ts) && offsets[i] <= chunk.size - chunk.rows * sizeof(Ts)
+                    && offsets[i++] % alignof(Ts) == 0));
+            }
+
+            int fd_{ -1 };
+            const std::byte* base_{};
+            std::size_t size_{};
+    };
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "registry.hpp"
+
+namespace ecs {
+
+    /// @brief Runs systems in the order they were added. Reactive systems name the components they
+    /// react to and are skipped as a whole while none of those columns changed since their last run,
+    /// checked per archetype through the change versions of the registry. A system that does run
+    /// gets the version of its last run and can limit itself to the changed chunks:
+    ///
+    ///     scheduler.add_reactive<position>([](ecs::registry& reg, std::uint64_t since) {
+    ///         reg.view<const position&, bounds&>().each_changed<position>(since, update_bounds);
+    ///     });
+    ///
+    /// The change version is advanced after every system, so a system does not wake itself up with
+    /// its own writes but does see the writes of all systems that ran after it.
+    class scheduler {
+
+        public:
+
+            using system_type = std::function<void(registry&, std::uint64_t)>;
+
+            /// @brief Construct a scheduler for the systems of a registry
+            /// @param reg registry, must outlive the scheduler
+            explicit scheduler(registry& reg) noexcept : registry_(&reg) {}
+
+            /// @brief Add a system that runs on every run()
+            /// @param system callable as system(registry&)
+            void add(std::function<void(registry&)> system) {
+                systems_.push_back({
+                    [system = std::move(system)](registry& reg, std::uint64_t) { system(reg); },
+                    nullptr,
+                    0,
+                });
+            }
+
+            /// @brief Add a system that only runs when the column of a Watched component changed
+            /// in some archetype since the system last ran. The first run() always runs it if
+            /// entities with a Watched component exist.
+            /// @tparam Watched component types
+            /// @param system callable as system(registry&, version of the last run)
+            template<component... Watched>
+            void add_reactive(system_type system) {
+                systems_.push_back({
+                    std::move(system),
+                    [](const registry& reg, std::uint64_t since) { return reg.changed<Watched...>(since); },
+                    0,
+                });
+            }
+
+            /// @brief Run all systems whose inputs changed
+            /// @return std::size_t number of systems skipped
+            std::size_t run() {
+                std::size_t skipped = 0;
+                for (auto& entry : systems_) {
+                    if (entry.changed != nullptr && !entry.changed(*registry_, entry.last_run)) {
+                        skipped++;
+                        continue;
+                    }
+                    const auto version = registry_->version();
+                    entry.system(*registry_, entry.last_run);
+                    entry.last_run = version;
+                    registry_->advance_version();
+                }
+                return skipped;
+            }
+
+            /// @brief Returns the number of systems
+            [[nodiscard]] std::size_t size() const noexcept {
+                return systems_.size();
+            }
+
+        private:
+
+            struct system_entry {
+                system_type system;
+                bool (*changed)(const registry&, std::uint64_t);
+                std::uint64_t last_run;
+            };
+
+            registry* registry_;
+            std::vector<system_entry> systems_;
+    };
+
+}
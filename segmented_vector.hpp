@@ -0,0 +1,229 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace ecs {
+
+    /// @brief Sequence container whose elements never move. Elements live in segments of doubling
+    /// size, starting at first_segment, reached through a fixed directory of segment pointers.
+    /// Appending allocates at most one new segment and never touches existing elements, so
+    /// references, pointers and indices stay valid until the element is popped. Indexing is O(1):
+    /// the segment of an index follows from its bit width.
+    ///
+    /// @tparam T Element type
+    /// @tparam first_segment Number of elements in the first segment, a power of two
+    template<typename T, std::size_t first_segment = 8>
+        requires(std::has_single_bit(first_segment))
+    class segmented_vector {
+        static constexpr std::size_t first_shift = std::countr_zero(first_segment);
+        static constexpr std::size_t max_segments = sizeof(std::size_t) * 8 - first_shift;
+
+        template<bool is_const>
+        class iterator_impl {
+            using container_type = std::conditional_t<is_const, const segmented_vector, segmented_vector>;
+
+            public:
+                using iterator_concept = std::random_access_iterator_tag;
+                using iterator_category = std::random_access_iterator_tag;
+                using difference_type = std::ptrdiff_t;
+                using value_type = T;
+                using pointer = std::conditional_t<is_const, const T*, T*>;
+                using reference = std::conditional_t<is_const, const T&, T&>;
+
+                constexpr iterator_impl() noexcept = default;
+
+                constexpr iterator_impl(container_type* container, std::size_t index) noexcept
+                    : _container(container), _index(index) {}
+
+                /// @brief Conversion from a mutable iterator
+                template<bool rhs_const>
+                    requires(is_const && !rhs_const)
+                constexpr iterator_impl(const iterator_impl<rhs_const>& rhs) noexcept
+                    : _container(rhs._container), _index(rhs._index) {}
+
+                reference operator*() const noexcept { return (*_container)[_index]; }
+                pointer operator->() const noexcept { return &**this; }
+                reference operator[](difference_type n) const noexcept { return *(*this + n); }
+
+                constexpr iterator_impl& operator++() noexcept { ++_index; return *this; }
+                constexpr iterator_impl operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+                constexpr iterator_impl& operator--() noexcept { --_index; return *this; }
+                constexpr iterator_impl operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+                constexpr iterator_impl& operator+=(difference_type n) noexcept { _index += n; return *this; }
+                constexpr iterator_impl& operator-=(difference_type n) noexcept { _index -= n; return *this; }
+
+                friend constexpr iterator_impl operator+(iterator_impl iter, difference_type n) noexcept { return iter += n; }
+                friend constexpr iterator_impl operator+(difference_type n, iterator_impl iter) noexcept { return iter += n; }
+                friend constexpr iterator_impl operator-(iterator_impl iter, difference_type n) noexcept { return iter -= n; }
+                friend constexpr difference_type operator-(const iterator_impl& lhs, const iterator_impl& rhs) noexcept {
+                    return static_cast<difference_type>(lhs._index) - static_cast<difference_type>(rhs._index);
+                }
+
+                friend constexpr bool operator==(const iterator_impl& lhs, const iterator_impl& rhs) noexcept {
+                    return lhs._index == rhs._index;
+                }
+                friend constexpr auto operator<=>(const iterator_impl& lhs, const iterator_impl& rhs) noexcept {
+                    return lhs._index <=> rhs._index;
+                }
+
+            private:
+                template<bool>
+                friend class iterator_impl;
+
+                container_type* _container{};
+                std::size_t _index{};
+        };
+
+        public:
+            using value_type = T;
+            using size_type = std::size_t;
+            using reference = T&;
+            using const_reference = const T&;
+            using iterator = iterator_impl<false>;
+            using const_iterator = iterator_impl<true>;
+
+            segmented_vector() noexcept = default;
+
+            segmented_vector(const segmented_vector&) = delete;
+            segmented_vector& operator=(const segmented_vector&) = delete;
+
+            segmented_vector(segmented_vector&& rhs) noexcept
+                : _segments(std::exchange(rhs._segments, {})), _size(std::exchange(rhs._size, 0)) {}
+
+            segmented_vector& operator=(segmented_vector&& rhs) noexcept {
+                if (this != &rhs) {
+                    release();
+                    _segments = std::exchange(rhs._segments, {});
+                    _size = std::exchange(rhs._size, 0);
+                }
+                return *this;
+            }
+
+            ~segmented_vector() {
+                release();
+            }
+
+            /// @brief Construct an element at the end
+            ///
+            /// @param args Constructor arguments
+            /// @return T& The new element
+            template<typename... Args>
+            T& emplace_back(Args&&... args) {
+                const auto [segment, offset] = locate(_size);
+                if (_segments[segment] == nullptr) {
+                    _segments[segment] = allocator_traits::allocate(_allocator, segment_size(segment));
+                }
+                auto* element = std::construct_at(_segments[segment] + offset, std::forward<Args>(args)...);
+                _size++;
+                return *element;
+            }
+
+            /// @brief Destroy the last element. Its segment is kept for the next append.
+            void pop_back() noexcept {
+                assert((_size != 0) && "Container is empty");
+                std::destroy_at(&back());
+                _size--;
+            }
+
+            /// @brief Destroy all elements, segments are kept
+            void clear() noexcept {
+                while (_size != 0) {
+                    pop_back();
+                }
+            }
+
+            /// @brief Allocate the segments for n elements, appending up to n elements does not allocate
+            ///
+            /// @param n Number of elements
+            void reserve(std::size_t n) {
+                if (n == 0) {
+                    return;
+                }
+                const auto last = locate(n - 1).first;
+                for (std::size_t segment = 0; segment <= last; ++segment) {
+                    if (_segments[segment] == nullptr) {
+                        _segments[segment] = allocator_traits::allocate(_allocator, segment_size(segment));
+                    }
+                }
+            }
+
+            T& operator[](std::size_t index) noexcept {
+                const auto [segment, offset] = locate(index);
+                return _segments[segment][offset];
+            }
+
+            const T& operator[](std::size_t index) const noexcept {
+                const auto [segment, offset] = locate(index);
+                return _segments[segment][offset];
+            }
+
+            T& at(std::size_t index) {
+                if (index >= _size) {
+                    throw std::out_of_range{"segmented_vector index out of range"};
+                }
+                return (*this)[index];
+            }
+
+            const T& at(std::size_t index) const {
+                if (index >= _size) {
+                    throw std::out_of_range{"segmented_vector index out of range"};
+                }
+                return (*this)[index];
+            }
+
+            T& front() noexcept { return (*this)[0]; }
+            const T& front() const noexcept { return (*this)[0]; }
+            T& back() noexcept { return (*this)[_size - 1]; }
+            const T& back() const noexcept { return (*this)[_size - 1]; }
+
+            [[nodiscard]] std::size_t size() const noexcept { return _size; }
+            [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+
+            iterator begin() noexcept { return iterator(this, 0); }
+            iterator end() noexcept { return iterator(this, _size); }
+            const_iterator begin() const noexcept { return const_iterator(this, 0); }
+            const_iterator end() const noexcept { return const_iterator(this, _size); }
+            const_iterator cbegin() const noexcept { return begin(); }
+            const_iterator cend() const noexcept { return end(); }
+
+        private:
+            using allocator_type = std::allocator<T>;
+            using allocator_traits = std::allocator_traits<allocator_type>;
+
+            static constexpr std::size_t segment_size(std::size_t segment) noexcept {
+                return first_segment << segment;
+            }
+
+            /// @brief Segment and offset of an index. Segment s starts at first_segment * (2^s - 1),
+            /// so index + first_segment has its highest bit at first_shift + s.
+            static constexpr std::pair<std::size_t, std::size_t> locate(std::size_t index) noexcept {
+                const auto shifted = index + first_segment;
+                const auto segment = static_cast<std::size_t>(std::bit_width(shifted)) - 1 - first_shift;
+                return { segment, shifted - segment_size(segment) };
+            }
+
+            void release() noexcept {
+                clear();
+                for (std::size_t segment = 0; segment < max_segments; ++segment) {
+                    if (_segments[segment] != nullptr) {
+                        allocator_traits::deallocate(_allocator, _segments[segment], segment_size(segment));
+                        _segments[segment] = nullptr;
+                    }
+                }
+            }
+
+            [[no_unique_address]] allocator_type _allocator{};
+            std::array<T*, max_segments> _segments{};
+            std::size_t _size{};
+    };
+
+}
@@ -1,15 +1,91 @@
 #pragma once
 
+#include <algorithm>
+#include <compare>
+#include <iterator>
 #include <memory>
+#include <numeric>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
 namespace ecs {
 
+    /// @brief Random access iterator over the parallel key and value arrays of a sparse map. Dereferencing
+    /// yields a pair of references, so structured bindings and iter->second work as with a pair array.
+    ///
+    /// @tparam K Key type
+    /// @tparam T Mapped type
+    /// @tparam is_const Whether the mapped values are const
+    template<typename K, typename T, bool is_const>
+    class sparse_zip_iterator {
+        public:
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::input_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using value_type = std::pair<K, T>;
+            using mapped_pointer = std::conditional_t<is_const, const T*, T*>;
+            using reference = std::pair<const K&, std::conditional_t<is_const, const T&, T&>>;
+
+            /// @brief Holds the pair of references for operator->
+            struct pointer {
+                reference ref;
+
+                constexpr const reference* operator->() const noexcept {
+                    return &ref;
+                }
+            };
+
+            constexpr sparse_zip_iterator() noexcept = default;
+
+            constexpr sparse_zip_iterator(const K* key, mapped_pointer value) noexcept : _key(key), _value(value) {}
+
+            /// @brief Conversion from a mutable iterator
+            template<bool rhs_const>
+                requires(is_const && !rhs_const)
+            constexpr sparse_zip_iterator(const sparse_zip_iterator<K, T, rhs_const>& rhs) noexcept
+                : _key(rhs._key), _value(rhs._value) {}
+
+            constexpr reference operator*() const noexcept { return reference(*_key, *_value); }
+            constexpr pointer operator->() const noexcept { return pointer{**this}; }
+            constexpr reference operator[](difference_type n) const noexcept { return *(*this + n); }
+
+            constexpr sparse_zip_iterator& operator++() noexcept { ++_key; ++_value; return *this; }
+            constexpr sparse_zip_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+            constexpr sparse_zip_iterator& operator--() noexcept { --_key; --_value; return *this; }
+            constexpr sparse_zip_iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+            constexpr sparse_zip_iterator& operator+=(difference_type n) noexcept { _key += n; _value += n; return *this; }
+            constexpr sparse_zip_iterator& operator-=(difference_type n) noexcept { _key -= n; _value -= n; return *this; }
+
+            friend constexpr sparse_zip_iterator operator+(sparse_zip_iterator iter, difference_type n) noexcept { return iter += n; }
+            friend constexpr sparse_zip_iterator operator+(difference_type n, sparse_zip_iterator iter) noexcept { return iter += n; }
+            friend constexpr sparse_zip_iterator operator-(sparse_zip_iterator iter, difference_type n) noexcept { return iter -= n; }
+            friend constexpr difference_type operator-(const sparse_zip_iterator& lhs, const sparse_zip_iterator& rhs) noexcept {
+                return lhs._key - rhs._key;
+            }
+
+            friend constexpr bool operator==(const sparse_zip_iterator& lhs, const sparse_zip_iterator& rhs) noexcept {
+                return lhs._key == rhs._key;
+            }
+            friend constexpr auto operator<=>(const sparse_zip_iterator& lhs, const sparse_zip_iterator& rhs) noexcept {
+                return lhs._key <=> rhs._key;
+            }
+
+        private:
+            template<typename, typename, bool>
+            friend class sparse_zip_iterator;
+
+            const K* _key{};
+            mapped_pointer _value{};
+    };
+
     /// @brief Sparse table implementation.
     /// @details The underlying layout is:
-    ///          dense:  |value_type|value_type|value_type|value_type|
-    ///          sparse: |key_type|          |key_type|key_type|          |key_type|
+    ///          keys:   |key_type|key_type|key_type|key_type|
+    ///          values: |mapped_type|mapped_type|mapped_type|mapped_type|
+    ///          sparse: |index|          |index|index|          |index|
+    ///          Keys and values live in separate dense arrays, so loops over the values and key
+    ///          comparisons of lookups each only touch the array they need.
     ///
     /// @tparam K Key type
     /// @tparam T Mapped type type
@@ -23,12 +99,13 @@ namespace ecs {
             using size_type = std::size_t;
             using difference_type = std::ptrdiff_t;
             using allocator_type = Allocator;
-            using reference = value_type&;
-            using const_reference = const value_type&;
-            using pointer = typename std::allocator_traits<allocator_type>::pointer;
-            using const_pointer = typename std::allocator_traits<allocator_type>::const_pointer;
-            using iterator = typename std::vector<value_type>::iterator;
-            using const_iterator = typename std::vector<value_type>::const_iterator;
+            using key_allocator_type = typename std::allocator_traits<allocator_type>::template rebind_alloc<key_type>;
+            using mapped_allocator_type = typename std::allocator_traits<allocator_type>::template rebind_alloc<
+                std::conditional_t<is_map, mapped_type, key_type>>;
+            using iterator = std::conditional_t<is_map, sparse_zip_iterator<key_type, mapped_type, false>,
+                typename std::vector<key_type, key_allocator_type>::const_iterator>;
+            using const_iterator = std::conditional_t<is_map, sparse_zip_iterator<key_type, mapped_type, true>,
+                typename std::vector<key_type, key_allocator_type>::const_iterator>;
 
             static_assert(sizeof(key_type) <= sizeof(std::size_t));
 
@@ -64,52 +141,70 @@ namespace ecs {
             ///
             /// @param list Initializer list
             constexpr sparse_table(std::initializer_list<value_type> list) {
-                _dense.reserve(list.size());
-                for (const auto& entry : list) {
-                    insert(entry);
-                }
+                insert(list.begin(), list.end());
             }
 
             /// @brief Return iterator to the beginning of the container
             ///
             /// @return Iterator pointing to the beginning
             constexpr iterator begin() noexcept {
-                return _dense.begin();
+                return iterator_at(*this, 0);
             }
 
             /// @brief Return iterator to the end of the container
             ///
             /// @return Iterator pointing to the end
             constexpr iterator end() noexcept {
-                return _dense.end();
+                return iterator_at(*this, size());
             }
 
             /// @brief Return const iterator to the beginning of the container
             ///
             /// @return Const iterator pointing to the beginning
             constexpr const_iterator begin() const noexcept {
-                return _dense.begin();
+                return iterator_at(*this, 0);
             }
 
             /// @brief Return const iterator to the end of the container
             ///
             /// @return Const iterator pointing to the end
             constexpr const_iterator end() const noexcept {
-                return _dense.end();
+                return iterator_at(*this, size());
             }
 
             /// @brief Return const iterator to the beginning of the container
             ///
             /// @return Const iterator pointing to the beginning
             constexpr const_iterator cbegin() const noexcept {
-                return _dense.cbegin();
+                return begin();
             }
 
             /// @brief Return const iterator to the end of the container
             ///
             /// @return Const iterator pointing to the end
             constexpr const_iterator cend() const noexcept {
-                return _dense.cend();
+                return end();
+            }
+
+            /// @brief Dense array of keys, in iteration order
+            ///
+            /// @return Keys
+            [[nodiscard]] constexpr std::span<const key_type> keys() const noexcept {
+                return _keys;
+            }
+
+            /// @brief Dense array of mapped values, in iteration order
+            ///
+            /// @return Values
+            [[nodiscard]] constexpr std::span<mapped_type> values() noexcept requires(is_map) {
+                return _values;
+            }
+
+            /// @brief Dense array of mapped values, in iteration order
+            ///
+            /// @return Values
+            [[nodiscard]] constexpr std::span<const mapped_type> values() const noexcept requires(is_map) {
+                return _values;
             }
 
             /// @brief Return the size of the container
@@ -133,7 +228,10 @@ namespace ecs {
 
             /// @brief Clear elements inside container
             constexpr void clear() noexcept {
-                _dense.clear();
+                _keys.clear();
+                if constexpr (is_map) {
+                    _values.clear();
+                }
                 _size = 0;
             }
 
@@ -141,7 +239,10 @@ namespace ecs {
             ///
             /// @param capacity
             constexpr void reserve_dense(std::size_t capacity) {
-                _dense.reserve(capacity);
+                _keys.reserve(capacity);
+                if constexpr (is_map) {
+                    _values.reserve(capacity);
+                }
             }
 
             /// @brief Reserve space in sparse vector
@@ -179,7 +280,7 @@ namespace ecs {
             /// @param key Key to test
             /// @return True if key is found in the container
             constexpr bool contains(key_type key) const noexcept {
-                return find(key) != end();
+                return key < _sparse_capacity && _sparse[key] < _size && _keys[_sparse[key]] == key;
             }
 
             /// @brief Insert a value inside the container
@@ -189,7 +290,30 @@ namespace ecs {
             /// boolean
             ///         set to true in case the insertion happened
             constexpr std::pair<iterator, bool> insert(const value_type& entry) {
-                return emplace(get_key(entry), std::move(get_value(entry)));
+                if constexpr (is_map) {
+                    return emplace(entry.first, entry.second);
+                } else {
+                    return emplace(entry);
+                }
+            }
+
+            /// @brief Insert a range of values, growing the sparse and dense vectors once up front
+            ///
+            /// @param first First iterator
+            /// @param last Last iterator
+            template<std::forward_iterator input_iterator>
+            constexpr void insert(input_iterator first, input_iterator last) {
+                std::size_t max_key = 0;
+                for (auto iter = first; iter != last; ++iter) {
+                    max_key = std::max<std::size_t>(max_key, get_key(*iter));
+                }
+                if (first != last) {
+                    reserve_sparse(max_key + 1);
+                }
+                reserve_dense(size() + static_cast<std::size_t>(std::distance(first, last)));
+                for (; first != last; ++first) {
+                    insert(*first);
+                }
             }
 
             /// @brief Emplace if the key does not exist yet
@@ -203,21 +327,18 @@ namespace ecs {
             template<typename... Args>
             constexpr std::pair<iterator, bool> emplace(key_type key, Args&&... args) {
                 if (contains(key)) {
-                    return std::pair(_dense.begin() + _sparse[key], false);
+                    return std::pair(iterator_at(*this, _sparse[key]), false);
                 }
 
                 reserve_sparse(static_cast<std::size_t>(key) + 1);
 
                 if constexpr (is_map) {
-                    _dense.emplace_back(std::piecewise_construct,
-                        std::forward_as_tuple(key),
-                        std::forward_as_tuple(std::forward<Args>(args)...));
-                } else {
-                    _dense.emplace_back(key);
+                    _values.emplace_back(std::forward<Args>(args)...);
                 }
+                _keys.push_back(key);
                 _sparse[key] = _size;
                 ++_size;
-                return std::pair(_dense.begin() + _sparse[key], true);
+                return std::pair(iterator_at(*this, _sparse[key]), true);
             }
 
             /// @brief Find an element and return a reference to it
@@ -230,7 +351,7 @@ namespace ecs {
                 if (!contains(key)) {
                     throw std::out_of_range("Key is not in the BaseSparseSet");
                 }
-                return get_value(_dense[_sparse[key]]);
+                return _values[_sparse[key]];
             }
 
             /// @brief Find an element and return a const reference to it
@@ -243,7 +364,7 @@ namespace ecs {
                 if (!contains(key)) {
                     throw std::out_of_range("Key is not in the BaseSparseSet");
                 }
-                return get_value(_dense[_sparse[key]]);
+                return _values[_sparse[key]];
             }
 
             /// @brief Find or default construct and insert an element and return a
@@ -252,9 +373,8 @@ namespace ecs {
             /// @param key Key to look for
             /// @return Reference to element found or inserted
             constexpr mapped_type& operator[](const key_type& key) noexcept requires(is_map) {
-                auto [iter, _] = emplace(key);
-                mapped_type& value = get_value(*iter);
-                return value;
+                emplace(key);
+                return _values[_sparse[key]];
             }
 
             /// @brief Erase the key from the container
@@ -263,41 +383,137 @@ namespace ecs {
             /// @return Number of elements erased
             constexpr std::size_t erase(key_type key) noexcept {
                 if (contains(key)) {
-                    _dense[_sparse[key]] = std::move(_dense.back());
-                    _sparse[get_key(_dense[_size - 1])] = _sparse[key];
-                    _dense.pop_back();
+                    const auto index = _sparse[key];
+                    const auto last = _keys.back();
+                    _keys[index] = last;
+                    _keys.pop_back();
+                    if constexpr (is_map) {
+                        _values[index] = std::move(_values.back());
+                        _values.pop_back();
+                    }
+                    _sparse[last] = index;
                     _size--;
                     return 1;
                 }
                 return 0;
             }
 
+            /// @brief Erase several keys in one pass. Unlike erase(key) the remaining entries keep their
+            /// relative order, so a sorted container stays sorted.
+            ///
+            /// @param keys Keys to erase, missing keys are ignored
+            /// @return Number of elements erased
+            constexpr std::size_t erase(std::span<const key_type> keys) {
+                std::vector<bool> erased(_size);
+                std::size_t count = 0;
+                for (const auto key : keys) {
+                    if (contains(key) && !erased[_sparse[key]]) {
+                        erased[_sparse[key]] = true;
+                        count++;
+                    }
+                }
+                if (count == 0) {
+                    return 0;
+                }
+                std::size_t out = 0;
+                for (std::size_t index = 0; index < _size; ++index) {
+                    if (erased[index]) {
+                        continue;
+                    }
+                    if (out != index) {
+                        _keys[out] = _keys[index];
+                        if constexpr (is_map) {
+                            _values[out] = std::move(_values[index]);
+                        }
+                    }
+                    _sparse[_keys[out]] = static_cast<key_type>(out);
+                    out++;
+                }
+                _keys.resize(out);
+                if constexpr (is_map) {
+                    _values.erase(_values.begin() + static_cast<difference_type>(out), _values.end());
+                }
+                _size = static_cast<key_type>(out);
+                return count;
+            }
+
+            /// @brief Sort the dense arrays by key, so iteration visits keys in ascending order and
+            /// neighbouring keys are stored next to each other
+            constexpr void sort() {
+                if constexpr (is_map) {
+                    std::vector<key_type> order(_size);
+                    std::iota(order.begin(), order.end(), key_type{});
+                    std::sort(order.begin(), order.end(), [this](auto lhs, auto rhs) { return _keys[lhs] < _keys[rhs]; });
+
+                    std::vector<mapped_type, mapped_allocator_type> values(_values.get_allocator());
+                    values.reserve(_size);
+                    for (const auto index : order) {
+                        values.push_back(std::move(_values[index]));
+                    }
+                    _values = std::move(values);
+                }
+                std::sort(_keys.begin(), _keys.end());
+                for (std::size_t index = 0; index < _size; ++index) {
+                    _sparse[_keys[index]] = static_cast<key_type>(index);
+                }
+            }
+
+            /// @brief Position of a key inside the dense vector, key must be present
+            ///
+            /// @param key Key to look for
+            /// @return Dense index of the key
+            constexpr size_type index_of(key_type key) const noexcept {
+                return _sparse[key];
+            }
+
+            /// @brief Swap two entries of the dense vector, keeping lookups intact
+            ///
+            /// @param lhs Dense index of first entry
+            /// @param rhs Dense index of second entry
+            constexpr void swap_entries(size_type lhs, size_type rhs) noexcept {
+                if (lhs == rhs) {
+                    return;
+                }
+                std::swap(_sparse[_keys[lhs]], _sparse[_keys[rhs]]);
+                std::swap(_keys[lhs], _keys[rhs]);
+                if constexpr (is_map) {
+                    std::swap(_values[lhs], _values[rhs]);
+                }
+            }
+
         private:
+            /// @brief Placeholder for the value array of sets
+            struct no_values {};
+
+            using mapped_storage = std::conditional_t<is_map, std::vector<mapped_type, mapped_allocator_type>, no_values>;
+
             constexpr static decltype(auto) find_impl(auto& self, auto& key) {
-                if (key < self._sparse_capacity && self._sparse[key] < self._size
-                    && get_key(self._dense[self._sparse[key]]) == key) {
-                    return self.begin() + self._sparse[key];
+                if (self.contains(key)) {
+                    return iterator_at(self, self._sparse[key]);
                 }
                 return self.end();
             }
 
-            constexpr static auto& get_key(auto& entry) {
+            constexpr static auto iterator_at(auto& self, std::size_t index) noexcept {
+                using iterator_type = std::conditional_t<std::is_const_v<std::remove_reference_t<decltype(self)>>,
+                    const_iterator, iterator>;
                 if constexpr (is_map) {
-                    return entry.first;
+                    return iterator_type(self._keys.data() + index, self._values.data() + index);
                 } else {
-                    return entry;
+                    return iterator_type(self._keys.begin() + static_cast<difference_type>(index));
                 }
             }
 
-            constexpr static auto& get_value(auto& entry) {
+            constexpr static auto get_key(const auto& entry) {
                 if constexpr (is_map) {
-                    return entry.second;
+                    return entry.first;
                 } else {
                     return entry;
                 }
             }
 
-            std::vector<value_type, Allocator> _dense;
+            std::vector<key_type, key_allocator_type> _keys;
+            [[no_unique_address]] mapped_storage _values;
             std::vector<key_type> _sparse;
 
             key_type _size{};
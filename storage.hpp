@@ -0,0 +1,759 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ECS_HAS_MMAP 1
+#endif
+
+namespace ecs {
+
+    /// @brief Source of the raw buffers mem_blocks store their components in. Implementations
+    /// return nullptr from allocate() when they are exhausted instead of throwing.
+    class block_storage {
+
+        public:
+
+            /// @brief Minimum alignment of returned buffers, enough for SIMD loads of lane blocks
+            static constexpr std::size_t alignment = 64;
+
+            virtual ~block_storage() = default;
+
+            /// @brief Allocate a buffer
+            /// @param size buffer size in bytes
+            /// @return pointer to the buffer or nullptr if the storage is exhausted
+            [[nodiscard]] virtual std::byte* allocate(std::size_t size) noexcept = 0;
+
+            /// @brief Return a buffer obtained from allocate()
+            /// @param ptr buffer
+            /// @param size buffer size in bytes, same as passed to allocate()
+            virtual void deallocate(std::byte* ptr, std::size_t size) noexcept = 0;
+
+            /// @brief Flush buffers to their backing store, no-op for volatile storages
+            virtual void sync() {}
+    };
+
+    /// @brief Default storage, buffers come from the heap
+    class heap_storage final : public block_storage {
+
+        public:
+
+            [[nodiscard]] std::byte* allocate(std::size_t size) noexcept override {
+                return reinterpret_cast<std::byte*>(std::aligned_alloc(alignment, (size + alignment - 1U) & ~(alignment - 1U)));
+            }
+
+            void deallocate(std::byte* ptr, [[maybe_unused]] std::size_t size) noexcept override {
+                std::free(ptr);
+            }
+
+            /// @brief Process wide heap storage instance
+            static heap_storage& instance() noexcept {
+                static heap_storage storage{};
+                return storage;
+            }
+    };
+
+    /// @brief Storage for small buffers which are carved out of shared slabs requested from an
+    /// upstream storage. A slab is split into up to 64 equally sized regions:
+    /// |region 0|region 1|...|region n - 1| and is returned upstream once all regions are free.
+    class small_block_storage final : public block_storage {
+
+        public:
+
+            /// @brief Construct small block storage
+            /// @param upstream storage slabs are allocated from, must outlive this storage
+            /// @param slab_size size of a slab requested from upstream
+            /// @param region_size size of a single region, slab_size / region_size must not exceed 64
+            small_block_storage(block_storage& upstream, std::size_t slab_size, std::size_t region_size) noexcept
+                : upstream_(&upstream), slab_size_(slab_size), region_size_(region_size),
+                  full_mask_(slab_size / region_size == 64 ? ~std::uint64_t{} : (std::uint64_t{ 1 } << (slab_size / region_size)) - 1) {}
+
+            small_block_storage(const small_block_storage&) = delete;
+            small_block_storage& operator=(const small_block_storage&) = delete;
+
+            ~small_block_storage() override {
+                for (auto& s : slabs_) {
+                    upstream_->deallocate(s.buffer, slab_size_);
+                }
+            }
+
+            [[nodiscard]] std::byte* allocate(std::size_t size) noexcept override {
+                if (size > region_size_) {
+                    return nullptr;
+                }
+                for (auto& s : slabs_) {
+                    if (s.used != full_mask_) {
+                        return take_region(s);
+                    }
+                }
+                auto* buffer = upstream_->allocate(slab_size_);
+                if (buffer == nullptr) {
+                    return nullptr;
+                }
+                slabs_.push_back(slab{ buffer, 0 });
+                return take_region(slabs_.back());
+            }
+
+            void deallocate(std::byte* ptr, [[maybe_unused]] std::size_t size) noexcept override {
+                for (auto& s : slabs_) {
+                    if (ptr < s.buffer || ptr >= s.buffer + slab_size_) {
+                        continue;
+                    }
+                    s.used &= ~(std::uint64_t{ 1 } << static_cast<std::size_t>(ptr - s.buffer) / region_size_);
+                    if (s.used == 0) {
+                        upstream_->deallocate(s.buffer, slab_size_);
+                        s = slabs_.back();
+                        slabs_.pop_back();
+                    }
+                    return;
+                }
+            }
+
+            void sync() override {
+                upstream_->sync();
+            }
+
+            /// @brief Size of a single region
+            [[nodiscard]] std::size_t region_size() const noexcept { return region_size_; }
+
+            /// @brief Number of slabs currently held from upstream
+            [[nodiscard]] std::size_t slab_count() const noexcept { return slabs_.size(); }
+
+        private:
+
+            struct slab {
+                std::byte* buffer;
+                std::uint64_t used;
+            };
+
+            std::byte* take_region(slab& s) noexcept {
+                const auto region = static_cast<std::size_t>(std::countr_one(s.used));
+                s.used |= std::uint64_t{ 1 } << region;
+                return s.buffer + region * region_size_;
+            }
+
+            block_storage* upstream_;
+            std::size_t slab_size_, region_size_;
+            std::uint64_t full_mask_;
+            std::vector<slab> slabs_{};
+    };
+
+    /// @brief Storage with a fixed number of equally sized blocks, all allocated up front in one
+    /// arena. Free blocks form an intrusive list, so allocate() and deallocate() are O(1) and never
+    /// touch the heap. allocate() returns nullptr once every block is in use.
+    class fixed_block_storage final : public block_storage {
+
+        public:
+
+            /// @brief Construct fixed block storage
+            /// @param capacity number of blocks
+            /// @param block_size size of a single block, a multiple of alignment
+            fixed_block_storage(std::size_t capacity, std::size_t block_size)
+                : capacity_(capacity), block_size_(block_size),
+                  arena_(capacity == 0 ? nullptr : static_cast<std::byte*>(std::aligned_alloc(alignment, capacity * block_size))) {
+                if (capacity != 0 && arena_ == nullptr) {
+                    throw std::bad_alloc{};
+                }
+                for (std::size_t i = capacity; i > 0; --i) {
+                    push(arena_ + (i - 1) * block_size_);
+                }
+            }
+
+            fixed_block_storage(const fixed_block_storage&) = delete;
+            fixed_block_storage& operator=(const fixed_block_storage&) = delete;
+
+            ~fixed_block_storage() override {
+                std::free(arena_);
+            }
+
+            [[nodiscard]] std::byte* allocate(std::size_t size) noexcept override {
+                if (size > block_size_ || free_head_ == nullptr) {
+                    return nullptr;
+                }
+                auto* ptr = free_head_;
+                std::memcpy(&free_head_, ptr, sizeof(free_head_));
+                available_--;
+                return ptr;
+            }
+
+            void deallocate(std::byte* ptr, [[maybe_unused]] std::size_t size) noexcept override {
+                push(ptr);
+            }
+
+            /// @brief Number of blocks
+            [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
+            /// @brief Number of free blocks
+            [[nodiscard]] std::size_t available() const noexcept { return available_; }
+
+            /// @brief Size of a single block
+            [[nodiscard]] std::size_t block_size() const noexcept { return block_size_; }
+
+        private:
+
+            void push(std::byte* ptr) noexcept {
+                std::memcpy(ptr, &free_head_, sizeof(free_head_));
+                free_head_ = ptr;
+                available_++;
+            }
+
+            std::size_t capacity_, block_size_;
+            std::byte* arena_;
+            std::byte* free_head_{};
+            std::size_t available_{};
+    };
+
+#ifdef ECS_HAS_MMAP
+
+    /// @brief Storage that hands out fixed size blocks from a memory mapped file. Blocks are
+    /// addressed by their offset into the file so the mapping may land at a different address
+    /// after a restart. The file layout is:
+    /// |header|directory 0|directory 1|padding to page|block 0|block 1|...|block capacity - 1|
+    /// Freed blocks form a singly linked list threaded through their first bytes. The file is
+    /// mapped copy-on-write: writes to blocks and the header stay in memory until commit() copies
+    /// the header, a directory and the blocks changed since the last commit into the file. A
+    /// commit is first written to a journal next to the file, "<path>.journal", and applied from
+    /// there, so a crash at any point leaves either the previous or the new checkpoint; an
+    /// interrupted journal is replayed or discarded when the file is mapped again. Changes that
+    /// were not committed are lost on destruction, see registry::checkpoint.
+    class mapped_file_storage final : public block_storage {
+
+        public:
+
+            /// @brief File signature, "ECSBLOCK"
+            static constexpr std::uint64_t file_magic = 0x4b434f4c42534345ULL;
+
+            /// @brief Bumped whenever the file layout changes
+            static constexpr std::uint32_t file_version = 2;
+
+            /// @brief Offset of the first directory slot
+            static constexpr std::size_t directory_offset = 4096;
+
+            /// @brief Persistent file header
+            struct header {
+                std::uint64_t magic;
+                std::uint32_t version;
+                /// @brief Directory slot of the last checkpoint, 0 or 1
+                std::uint32_t active;
+                std::uint64_t block_size;
+                std::uint64_t capacity;
+                std::uint64_t used;
+                std::uint64_t free_head;
+                std::uint64_t checkpoint;
+                std::uint64_t directory_capacity;
+                /// @brief Bytes used in each directory slot
+                std::uint64_t directory_size[2];
+            };
+
+            static_assert(sizeof(header) <= directory_offset, "Header overlaps the directory");
+
+            /// @brief Map or create the storage file. An existing file is validated against the
+            /// requested geometry, a mismatching or foreign file throws std::runtime_error. A
+            /// complete journal left by an interrupted commit is applied first.
+            /// @param path file path
+            /// @param capacity number of blocks the file holds
+            /// @param block_size size of a single block in bytes
+            /// @param directory_capacity bytes reserved for each of the two directory slots
+            mapped_file_storage(const std::string& path, std::size_t capacity, std::size_t block_size,
+                std::size_t directory_capacity = std::size_t{ 1 } << 22U)
+                : path_(path), block_size_(block_size), directory_capacity_(directory_capacity),
+                  data_offset_((directory_offset + 2 * directory_capacity + 4095U) & ~std::size_t{ 4095U }),
+                  mapped_size_(data_offset_ + capacity * block_size) {
+                fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+                if (fd_ < 0) {
+                    throw std::runtime_error{"Cannot open storage file " + path};
+                }
+
+                try {
+                    struct stat st{};
+                    ::fstat(fd_, &st);
+                    recovered_ = st.st_size > 0;
+
+                    if (recovered_) {
+                        if (static_cast<std::size_t>(st.st_size) < mapped_size_) {
+                            throw std::runtime_error{"Storage file " + path + " is truncated"};
+                        }
+                        replay_journal();
+                    } else {
+                        const header fresh{ file_magic, file_version, 0, block_size, capacity, 0, 0, 0, directory_capacity, { 0, 0 } };
+                        if (::ftruncate(fd_, static_cast<off_t>(mapped_size_)) != 0) {
+                            throw std::runtime_error{"Cannot resize storage file " + path};
+                        }
+                        write_all(fd_, reinterpret_cast<const std::byte*>(&fresh), sizeof(fresh), 0);
+                        sync_file(fd_);
+                    }
+                } catch (...) {
+                    ::close(fd_);
+                    throw;
+                }
+
+                void* base = ::mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd_, 0);
+                if (base == MAP_FAILED) {
+                    ::close(fd_);
+                    throw std::runtime_error{"Cannot map storage file " + path};
+                }
+                base_ = static_cast<std::byte*>(base);
+
+                if (recovered_) {
+                    validate(capacity);
+                }
+            }
+
+            mapped_file_storage(const mapped_file_storage&) = delete;
+            mapped_file_storage& operator=(const mapped_file_storage&) = delete;
+
+            /// @brief Unmap the file, changes since the last commit are discarded
+            ~mapped_file_storage() override {
+                ::munmap(base_, mapped_size_);
+                ::close(fd_);
+            }
+
+            [[nodiscard]] std::byte* allocate(std::size_t size) noexcept override {
+                auto* h = get_header();
+                if (size > h->block_size) {
+                    return nullptr;
+                }
+                if (h->free_head != 0) {
+                    auto* ptr = at(h->free_head);
+                    std::memcpy(&h->free_head, ptr, sizeof(h->free_head));
+                    return ptr;
+                }
+                if (h->used == h->capacity) {
+                    return nullptr;
+                }
+                return at(data_offset_ + h->used++ * h->block_size);
+            }
+
+            void deallocate(std::byte* ptr, [[maybe_unused]] std::size_t size) noexcept override {
+                auto* h = get_header();
+                std::memcpy(ptr, &h->free_head, sizeof(h->free_head));
+                h->free_head = offset_of(ptr);
+            }
+
+            /// @brief Checkpoint: commit the current directory with every block handed out so far
+            void sync() override {
+                std::vector<std::uint64_t> blocks(get_header()->used);
+                for (std::size_t i = 0; i < blocks.size(); ++i) {
+                    blocks[i] = data_offset_ + i * block_size_;
+                }
+                const auto* current = base_ + directory_offset + get_header()->active * directory_capacity_;
+                commit({ current, get_header()->directory_size[get_header()->active] }, blocks);
+            }
+
+            /// @brief Commit a checkpoint: write the directory into the inactive slot, switch the
+            /// header over to it and copy header, directory and the given blocks into the file
+            /// through the journal. Blocks not passed keep the contents of an earlier commit.
+            /// @param directory directory bytes, see registry::checkpoint
+            /// @param blocks offsets of the blocks changed since the last commit
+            /// @throws std::length_error if the directory does not fit a slot
+            /// @throws std::runtime_error if writing the file fails; if the journal was complete,
+            /// the commit is applied when the file is mapped again
+            void commit(std::span<const std::byte> directory, std::span<const std::uint64_t> blocks) {
+                auto* h = get_header();
+                if (directory.size() > directory_capacity_) {
+                    throw std::length_error{"Storage file directory is too small"};
+                }
+                const header previous = *h;
+                const auto slot = 1U - h->active;
+                const auto slot_offset = directory_offset + slot * directory_capacity_;
+                std::memcpy(base_ + slot_offset, directory.data(), directory.size());
+                h->directory_size[slot] = directory.size();
+                h->active = slot;
+                h->checkpoint++;
+
+                std::vector<std::pair<std::uint64_t, std::uint64_t>> ranges{ { 0, sizeof(header) }, { slot_offset, directory.size() } };
+                for (const auto offset : blocks) {
+                    ranges.emplace_back(offset, block_size_);
+                }
+                try {
+                    write_journal(ranges);
+                    for (const auto& [offset, size] : ranges) {
+                        write_all(fd_, base_ + offset, size, offset);
+                    }
+                    sync_file(fd_);
+                } catch (...) {
+                    *h = previous;
+                    throw;
+                }
+                ::unlink(journal_path().c_str());
+            }
+
+            /// @brief Directory of the last commit(), empty if there was none
+            [[nodiscard]] std::span<const std::byte> directory() const noexcept {
+                const auto* h = get_header();
+                return { base_ + directory_offset + h->active * directory_capacity_, h->directory_size[h->active] };
+            }
+
+            /// @brief Rebuild the free list after a restart: every block handed out so far that is not
+            /// live is free. Blocks allocated or freed after the last checkpoint are reclaimed this way.
+            /// @param live offsets of the blocks referenced by the directory
+            /// @throws std::runtime_error if an offset is not a block handed out so far
+            void recover(std::vector<std::uint64_t> live) {
+                auto* h = get_header();
+                std::ranges::sort(live);
+                const auto end = data_offset_ + h->used * block_size_;
+                for (std::size_t i = 0; i < live.size(); ++i) {
+                    if (live[i] < data_offset_ || live[i] >= end || (live[i] - data_offset_) % block_size_ != 0
+                        || (i != 0 && live[i] == live[i - 1])) {
+                        throw std::runtime_error{"Storage file directory references an invalid block"};
+                    }
+                }
+                h->free_head = 0;
+                for (auto offset = end; offset != data_offset_; offset -= block_size_) {
+                    if (!std::ranges::binary_search(live, offset - block_size_)) {
+                        deallocate(at(offset - block_size_), block_size_);
+                    }
+                }
+            }
+
+            /// @brief Relocatable offset of a pointer into the mapping
+            [[nodiscard]] std::uint64_t offset_of(const std::byte* ptr) const noexcept {
+                return static_cast<std::uint64_t>(ptr - base_);
+            }
+
+            /// @brief Resolve a relocatable offset into a pointer
+            [[nodiscard]] std::byte* at(std::uint64_t offset) const noexcept {
+                return base_ + offset;
+            }
+
+            /// @brief True if an existing file was mapped instead of creating a new one
+            [[nodiscard]] bool recovered() const noexcept { return recovered_; }
+
+            /// @brief Number of completed checkpoints stored in the file
+            [[nodiscard]] std::uint64_t checkpoint() const noexcept { return get_header()->checkpoint; }
+
+            [[nodiscard]] std::size_t block_size() const noexcept { return block_size_; }
+
+        private:
+
+            /// @brief Journal signature, "ECSJOURN"
+            static constexpr std::uint64_t journal_magic = 0x4e52554f4a534345ULL;
+
+            [[nodiscard]] header* get_header() const noexcept {
+                return reinterpret_cast<header*>(base_);
+            }
+
+            [[nodiscard]] std::string journal_path() const {
+                return path_ + ".journal";
+            }
+
+            /// @brief Write the journal of a commit: |magic|count|offset, size, bytes of each range|
+            /// followed by a trailer |magic|length| written only once the rest is on disk, so a
+            /// journal without a valid trailer was never applied and can be dropped
+            void write_journal(std::span<const std::pair<std::uint64_t, std::uint64_t>> ranges) {
+                const auto journal = journal_path();
+                const int fd = ::open(journal.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd < 0) {
+                    throw std::runtime_error{"Cannot open storage journal " + journal};
+                }
+                try {
+                    std::uint64_t length = 0;
+                    auto put = [&](const std::byte* bytes, std::size_t size) {
+                        write_all(fd, bytes, size, length);
+                        length += size;
+                    };
+                    const std::uint64_t head[2]{ journal_magic, ranges.size() };
+                    put(reinterpret_cast<const std::byte*>(head), sizeof(head));
+                    for (const auto& [offset, size] : ranges) {
+                        const std::uint64_t entry[2]{ offset, size };
+                        put(reinterpret_cast<const std::byte*>(entry), sizeof(entry));
+                        put(base_ + offset, size);
+                    }
+                    sync_file(fd);
+                    const std::uint64_t trailer[2]{ journal_magic, length };
+                    put(reinterpret_cast<const std::byte*>(trailer), sizeof(trailer));
+                    sync_file(fd);
+                    ::close(fd);
+                } catch (...) {
+                    ::close(fd);
+                    throw;
+                }
+                sync_parent_directory();
+            }
+
+            /// @brief Apply a complete journal to the file and remove it, drop an incomplete one
+            /// @throws std::runtime_error if a complete journal addresses bytes outside the file
+            void replay_journal() {
+                const auto journal = journal_path();
+                const int fd = ::open(journal.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    return;
+                }
+                std::vector<std::byte> bytes;
+                try {
+                    struct stat st{};
+                    ::fstat(fd, &st);
+                    bytes.resize(static_cast<std::size_t>(st.st_size));
+                    read_all(fd, bytes.data(), bytes.size(), 0);
+                    ::close(fd);
+                } catch (...) {
+                    ::close(fd);
+                    throw;
+                }
+
+                auto word = [&bytes](std::size_t position) {
+                    std::uint64_t value{};
+                    std::memcpy(&value, bytes.data() + position, sizeof(value));
+                    return value;
+                };
+                constexpr std::size_t word_size = sizeof(std::uint64_t);
+                const bool complete = bytes.size() >= 4 * word_size && word(0) == journal_magic
+                    && word(bytes.size() - 2 * word_size) == journal_magic
+                    && word(bytes.size() - word_size) == bytes.size() - 2 * word_size;
+                if (complete) {
+                    const auto length = bytes.size() - 2 * word_size;
+                    struct entry { std::size_t position; std::uint64_t offset, size; };
+                    std::vector<entry> entries;
+                    std::size_t position = 2 * word_size;
+                    for (std::uint64_t i = 0, count = word(word_size); i < count; ++i) {
+                        if (length - position < 2 * word_size) {
+                            throw std::runtime_error{"Storage journal is corrupt"};
+                        }
+                        const auto offset = word(position), size = word(position + word_size);
+                        position += 2 * word_size;
+                        if (size > length - position || offset > mapped_size_ || size > mapped_size_ - offset) {
+                            throw std::runtime_error{"Storage journal is corrupt"};
+                        }
+                        entries.push_back({ position, offset, size });
+                        position += size;
+                    }
+                    for (const auto& [from, offset, size] : entries) {
+                        write_all(fd_, bytes.data() + from, size, offset);
+                    }
+                    sync_file(fd_);
+                }
+                ::unlink(journal.c_str());
+            }
+
+            /// @brief Make the creation of the journal durable before the file is written through it
+            void sync_parent_directory() const {
+                const auto slash = path_.find_last_of('/');
+                const auto parent = slash == std::string::npos ? std::string{ "." } : path_.substr(0, slash + 1);
+                const int fd = ::open(parent.c_str(), O_RDONLY);
+                if (fd >= 0) {
+                    ::fsync(fd);
+                    ::close(fd);
+                }
+            }
+
+            static void write_all(int fd, const std::byte* bytes, std::size_t size, std::uint64_t offset) {
+                while (size > 0) {
+                    const auto written = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+                    if (written < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (written <= 0) {
+                        throw std::runtime_error{"Failed to write storage file"};
+                    }
+                    bytes += written;
+                    size -= static_cast<std::size_t>(written);
+                    offset += static_cast<std::uint64_t>(written);
+                }
+            }
+
+            static void read_all(int fd, std::byte* bytes, std::size_t size, std::uint64_t offset) {
+                while (size > 0) {
+                    const auto read = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+                    if (read < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (read <= 0) {
+                        throw std::runtime_error{"Failed to read storage file"};
+                    }
+                    bytes += read;
+                    size -= static_cast<std::size_t>(read);
+                    offset += static_cast<std::uint64_t>(read);
+                }
+            }
+
+            static void sync_file(int fd) {
+                if (::fsync(fd) != 0) {
+                    throw std::runtime_error{"Failed to flush storage file"};
+                }
+            }
+
+            void validate(std::size_t capacity) {
+                const auto* h = get_header();
+                const bool valid = h->magic == file_magic && h->version == file_version
+                    && h->block_size == block_size_ && h->capacity == capacity && h->used <= h->capacity
+                    && h->directory_capacity == directory_capacity_ && h->active < 2
+                    && h->directory_size[h->active] <= directory_capacity_
+                    && (h->free_head == 0 || (h->free_head >= data_offset_ && h->free_head < mapped_size_));
+                if (!valid) {
+                    ::munmap(base_, mapped_size_);
+                    ::close(fd_);
+                    throw std::runtime_error{"Storage file is not compatible"};
+                }
+            }
+
+            std::string path_;
+            int fd_{ -1 };
+            std::byte* base_{};
+            std::size_t block_size_{}, directory_capacity_{}, data_offset_{}, mapped_size_{};
+            bool recovered_{ false };
+    };
+
+    /// @brief Storage that hands out fixed size blocks from a POSIX shared memory object, so other
+    /// processes on the host can map the chunks read-only, see replica_writer and replica_reader.
+    /// Blocks are addressed by their offset into the object, each process maps it at its own
+    /// address. The layout is:
+    /// |header|directory|padding to page|block 0|block 1|...|block capacity - 1|
+    /// The directory is written by replica_writer, guarded by the sequence counter in the header.
+    /// The object is created on construction, replacing a stale one of the same name, and unlinked
+    /// on destruction; readers that still map it keep their mapping.
+    class shared_memory_storage final : public block_storage {
+
+        public:
+
+            /// @brief Object signature, "ECSSHARE"
+            static constexpr std::uint64_t shm_magic = 0x4552414853534345ULL;
+
+            /// @brief Bumped whenever the layout changes
+            static constexpr std::uint32_t shm_version = 2;
+
+            /// @brief Offset of the directory
+            static constexpr std::size_t directory_offset = 256;
+
+            /// @brief Header at offset 0, fields other than sequence are written once on creation
+            struct header {
+                std::uint64_t magic;
+                std::uint32_t version;
+                std::uint32_t reserved;
+                std::uint64_t block_size;
+                std::uint64_t capacity;
+                std::uint64_t used;
+                std::uint64_t free_head;
+                std::uint64_t directory_capacity;
+                std::uint64_t data_offset;
+                /// @brief Seqlock counter, odd while the writer changes the world
+                alignas(64) std::uint64_t sequence;
+            };
+
+            static_assert(sizeof(header) <= directory_offset, "Header overlaps the directory");
+
+            /// @brief Create the shared memory object
+            /// @param name object name, starting with a slash, e.g. "/game_world"
+            /// @param capacity number of blocks
+            /// @param block_size size of a single block in bytes
+            /// @param directory_capacity bytes reserved for the chunk directory
+            shared_memory_storage(std::string name, std::size_t capacity, std::size_t block_size,
+                std::size_t directory_capacity = std::size_t{ 1 } << 20U)
+                : name_(std::move(name)), block_size_(block_size),
+                  data_offset_((directory_offset + directory_capacity + 4095U) & ~std::size_t{ 4095U }),
+                  mapped_size_(data_offset_ + capacity * block_size) {
+                ::shm_unlink(name_.c_str());
+                fd_ = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+                if (fd_ < 0) {
+                    throw std::runtime_error{"Cannot create shared memory object " + name_};
+                }
+                if (::ftruncate(fd_, static_cast<off_t>(mapped_size_)) != 0) {
+                    close_and_unlink();
+                    throw std::runtime_error{"Cannot resize shared memory object " + name_};
+                }
+                void* base = ::mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+                if (base == MAP_FAILED) {
+                    close_and_unlink();
+                    throw std::runtime_error{"Cannot map shared memory object " + name_};
+                }
+                base_ = static_cast<std::byte*>(base);
+                *get_header() = header{ shm_magic, shm_version, 0, block_size, capacity, 0, 0, directory_capacity, data_offset_, 0 };
+            }
+
+            shared_memory_storage(const shared_memory_storage&) = delete;
+            shared_memory_storage& operator=(const shared_memory_storage&) = delete;
+
+            ~shared_memory_storage() override {
+                ::munmap(base_, mapped_size_);
+                close_and_unlink();
+            }
+
+            [[nodiscard]] std::byte* allocate(std::size_t size) noexcept override {
+                auto* h = get_header();
+                if (size > h->block_size) {
+                    return nullptr;
+                }
+                if (h->free_head != 0) {
+                    auto* ptr = at(h->free_head);
+                    std::memcpy(&h->free_head, ptr, sizeof(h->free_head));
+                    return ptr;
+                }
+                if (h->used == h->capacity) {
+                    return nullptr;
+                }
+                return at(data_offset_ + h->used++ * h->block_size);
+            }
+
+            void deallocate(std::byte* ptr, [[maybe_unused]] std::size_t size) noexcept override {
+                auto* h = get_header();
+                std::memcpy(ptr, &h->free_head, sizeof(h->free_head));
+                h->free_head = offset_of(ptr);
+            }
+
+            /// @brief Relocatable offset of a pointer into the mapping
+            [[nodiscard]] std::uint64_t offset_of(const std::byte* ptr) const noexcept {
+                return static_cast<std::uint64_t>(ptr - base_);
+            }
+
+            /// @brief Resolve a relocatable offset into a pointer
+            [[nodiscard]] std::byte* at(std::uint64_t offset) const noexcept {
+                return base_ + offset;
+            }
+
+            /// @brief True if ptr points into the block area of the mapping
+            [[nodiscard]] bool contains(const std::byte* ptr) const noexcept {
+                return ptr >= base_ + data_offset_ && ptr < base_ + mapped_size_;
+            }
+
+            /// @brief Directory area, see replica_writer
+            [[nodiscard]] std::byte* directory() const noexcept {
+                return base_ + directory_offset;
+            }
+
+            [[nodiscard]] std::size_t directory_capacity() const noexcept {
+                return get_header()->directory_capacity;
+            }
+
+            /// @brief Seqlock counter shared with the readers
+            [[nodiscard]] std::uint64_t& sequence() const noexcept {
+                return get_header()->sequence;
+            }
+
+            [[nodiscard]] const std::string& name() const noexcept { return name_; }
+
+            [[nodiscard]] std::size_t block_size() const noexcept { return block_size_; }
+
+        private:
+
+            [[nodiscard]] header* get_header() const noexcept {
+                return reinterpret_cast<header*>(base_);
+            }
+
+            void close_and_unlink() noexcept {
+                ::close(fd_);
+                ::shm_unlink(name_.c_str());
+            }
+
+            std::string name_;
+            int fd_{ -1 };
+            std::byte* base_{};
+            std::size_t block_size_{}, data_offset_{}, mapped_size_{};
+    };
+
+#endif
+
+}